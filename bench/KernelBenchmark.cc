@@ -0,0 +1,141 @@
+// Compares the speed of the ways of evaluating the fit model over a fit window:
+// the TFormula string, the TF1 wrapping the compiled SFFitFunction, and the
+// vectorised SFFitKernel, over the whole window and within +/- 8 sigma of each
+// peak. Prints the number of bins evaluated per second.
+#include "CommandLineInterface.hh"
+#include "FitFunction.hh"
+#include "FitKernel.hh"
+#include "MessageLogger.hh"
+#include "Peak.hh"
+#include "Spectrum.hh"
+
+#include <TF1.h>
+#include <TMath.h>
+#include <TString.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+MessageLogger* MessageLogger::m_instance_ptr = nullptr;
+
+///////////////////////////////////////////////////////////////////////////////
+// Time how long it takes to run f over all of the bins n_repeats times
+template <typename F>
+double BinsPerSecond( F f, const unsigned int n_bins, const unsigned int n_repeats ){
+	auto start = std::chrono::steady_clock::now();
+	for ( unsigned int i = 0; i < n_repeats; ++i ){
+		f();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return (double)n_bins*n_repeats/elapsed.count();
+}
+///////////////////////////////////////////////////////////////////////////////
+int main( int argc, char *argv[] ){
+	MessageLogger *log = MessageLogger::GetInstance();
+	log->SetPrintConsoleLevel( MessageLogger::LevelWarning );
+
+	// Options
+	TString s_bins = "10000";
+	TString s_peaks = "40";
+	TString s_repeats = "20";
+	bool help = false;
+
+	CommandLineInterface *interface = new CommandLineInterface();
+	interface->Add( "-b", "Number of bins in the fit window", &s_bins );
+	interface->Add( "-p", "Number of peaks in the fit", &s_peaks );
+	interface->Add( "-r", "Number of repeats", &s_repeats );
+	interface->Add( "-h", "Print this help", &help );
+	interface->CheckFlags( argc, argv );
+	if ( help ){
+		interface->CheckFlags( 1, argv );
+		delete interface;
+		return 0;
+	}
+
+	unsigned int n_bins = s_bins.Atoi();
+	unsigned int n_peaks = s_peaks.Atoi();
+	unsigned int n_repeats = s_repeats.Atoi();
+	double lb = 0.0;
+	double ub = 5.0*n_bins;
+
+	// Build a spectrum with evenly-spaced peaks and a single fit over all of them
+	SFSpectrum *spec = new SFSpectrum();
+	spec->SetSeparationEnergy( 0.75*ub );
+	spec->SetNumberOfFits(1);
+	SFFit *fit = spec->GetFit(0);
+	fit->SetBGPolyOrder(1);
+	fit->SetFitLimitLB( lb );
+	fit->SetFitLimitUB( ub );
+
+	for ( unsigned int i = 0; i < n_peaks; ++i ){
+		SFPeak *peak = new SFPeak();
+		peak->SetMean( lb + ( i + 0.5 )*( ub - lb )/n_peaks );
+		if ( peak->GetMean() < spec->GetSeparationEnergy() )peak->SetBound();
+		else peak->SetUnbound();
+		if ( i % 7 == 3 )peak->SetDoublet();
+		if ( i % 11 == 5 )peak->SetFixedWidth(1);
+		spec->AddPeak( peak );
+	}
+	spec->CalculateNumberOfPeaksAndFitParameters();
+	TString fit_string = fit->GenerateTotalFitString(0);
+
+	// Parameter values for each parameter type
+	std::vector<double> p( fit->GetNumberOfFitParameters() );
+	for ( unsigned int i = 0; i < p.size(); ++i ){
+		int peak_num = fit->GetFitParameter(i).peak;
+		SFFit::FitParameterType type = fit->GetFitParameterType(i);
+		if ( type == SFFit::FitParameterWidth )p[i] = ( i == 0 ? 50.0 : 80.0 );
+		else if ( type == SFFit::FitParameterWidthScale )p[i] = 1.3;
+		else if ( type == SFFit::FitParameterAmplitude )p[i] = 100.0 + peak_num;
+		else if ( type == SFFit::FitParameterMean )p[i] = spec->GetPeak( peak_num )->GetMean() + 3.0;
+		else if ( type == SFFit::FitParameterBackground )p[i] = ( peak_num == 0 ? 5.0 : -1e-5 );
+	}
+
+	// Bin centres
+	std::vector<double> x( n_bins );
+	std::vector<double> mu( n_bins );
+	for ( unsigned int i = 0; i < n_bins; ++i ){
+		x[i] = lb + ( i + 0.5 )*( ub - lb )/n_bins;
+	}
+
+	// The three ways of evaluating the model
+	TF1 *formula = new TF1( "formula", fit_string, lb, ub );
+	TF1 *compiled = new TF1( "compiled", SFFitFunction( fit, 0 ), lb, ub, p.size() );
+	SFFitKernel kernel( SFFitFunction( fit, 0 ), x );
+	SFFitKernel banded( SFFitFunction( fit, 0 ), x );
+	banded.SetPeakRange( 8.0 );
+	std::vector<double> mu_banded( n_bins );
+
+	double sink = 0.0;
+	double rate_formula = BinsPerSecond( [&](){ for ( unsigned int i = 0; i < n_bins; ++i )sink += formula->EvalPar( &x[i], p.data() ); }, n_bins, n_repeats );
+	double rate_compiled = BinsPerSecond( [&](){ for ( unsigned int i = 0; i < n_bins; ++i )sink += compiled->EvalPar( &x[i], p.data() ); }, n_bins, n_repeats );
+	double rate_kernel = BinsPerSecond( [&](){ kernel.Evaluate( p.data(), mu.data() ); sink += mu[0]; }, n_bins, n_repeats );
+	double rate_banded = BinsPerSecond( [&](){ banded.Evaluate( p.data(), mu_banded.data() ); sink += mu_banded[0]; }, n_bins, n_repeats );
+
+	// Check that they agree
+	double max_diff = 0.0;
+	double max_diff_banded = 0.0;
+	for ( unsigned int i = 0; i < n_bins; ++i ){
+		double ref = formula->EvalPar( &x[i], p.data() );
+		max_diff = TMath::Max( max_diff, TMath::Abs( mu[i] - ref )/TMath::Max( TMath::Abs( ref ), 1.0 ) );
+		max_diff_banded = TMath::Max( max_diff_banded, TMath::Abs( mu_banded[i] - ref )/TMath::Max( TMath::Abs( ref ), 1.0 ) );
+	}
+
+	int w = 16;
+	std::cout << "Bins: " << n_bins << ", peaks: " << n_peaks << ", parameters: " << p.size() << ", kernel: " << SFFitKernel::GetInstructionSet() << std::endl;
+	std::cout << std::left << std::setw(w) << "Method" << std::setw(w) << "Bins/second" << std::setw(w) << "Speed-up" << std::endl;
+	std::cout << std::left << std::setw(w) << "TFormula" << std::setw(w) << rate_formula << std::setw(w) << 1.0 << std::endl;
+	std::cout << std::left << std::setw(w) << "TF1 compiled" << std::setw(w) << rate_compiled << std::setw(w) << rate_compiled/rate_formula << std::endl;
+	std::cout << std::left << std::setw(w) << "SFFitKernel" << std::setw(w) << rate_kernel << std::setw(w) << rate_kernel/rate_formula << std::endl;
+	std::cout << std::left << std::setw(w) << "SFFitKernel 8s" << std::setw(w) << rate_banded << std::setw(w) << rate_banded/rate_formula << std::endl;
+	std::cout << "Largest relative difference from TFormula: " << max_diff << " (+/- 8 sigma: " << max_diff_banded << ", checksum " << sink << ")" << std::endl;
+
+	delete formula;
+	delete compiled;
+	delete spec;
+	delete interface;
+	delete log;
+	return 0;
+}
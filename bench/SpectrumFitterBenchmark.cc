@@ -0,0 +1,289 @@
+// Microbenchmarks of the hot paths, using Google Benchmark: building the model
+// string, evaluating the model in each bin, fitting, integrating and writing
+// the results, for synthetic spectra of increasing size. Run with "make bench",
+// which also writes the results as JSON for comparing between versions. Any
+// Google Benchmark option can be passed with BENCHFLAGS, e.g.
+//	$ make bench BENCHFLAGS="--benchmark_filter=FitPeaks"
+#include "FitFunction.hh"
+#include "FitKernel.hh"
+#include "FitWriter.hh"
+#include "IntegralEngine.hh"
+#include "MessageLogger.hh"
+#include "Peak.hh"
+#include "Spectrum.hh"
+#include "SpectrumFitter.hh"
+#include "SpectrumGenerator.hh"
+#include "SpectrumIntegral.hh"
+
+#include <TH1D.h>
+#include <TString.h>
+#include <TSystem.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+MessageLogger* MessageLogger::m_instance_ptr = nullptr;
+
+// Bin width and peak width of the synthetic spectra
+const double kBinWidth = 5.0;
+const double kPeakWidth = 30.0;
+
+///////////////////////////////////////////////////////////////////////////////
+// Evenly-spaced peaks on a flat background from SFSpectrumGenerator, which
+// gives the same spectrum every time. There is one fit over the whole
+// histogram, and one integral taking its background from the fit.
+SFSpectrum* MakeSpectrum( const unsigned int n_peaks, const unsigned int n_bins ){
+	double lb = 0.0;
+	double ub = kBinWidth*n_bins;
+
+	SFSpectrumGenerator sg;
+	sg.SetNumberOfPeaks( n_peaks );
+	sg.SetNumberOfBins( n_bins );
+	sg.SetRange( lb, ub );
+	sg.SetCounts( 4000.0*n_peaks );
+	sg.SetWidth( kPeakWidth );
+	sg.GeneratePeaks();
+	TH1D *h = sg.GenerateHistogram( Form( "bench_%u_%u", n_peaks, n_bins ) );
+
+	SFSpectrum *spec = new SFSpectrum();
+	spec->SetHist( std::shared_ptr<const TH1>(h) );
+	spec->SetSeparationEnergy( 0.75*ub );
+	spec->SetGuessWidth( kPeakWidth );
+	spec->SetGuessWidthLB( 0.3*kPeakWidth );
+	spec->SetGuessWidthUB( 2.0*kPeakWidth );
+	spec->SetGuessAmplitudeFractionLB( 0.0 );
+	spec->SetGuessAmplitudeFractionUB( 2.0 );
+	spec->SetGuessMeanHalfWidth( kPeakWidth );
+	spec->SetBoundPeakWidth( kPeakWidth );
+	spec->SetBoundPeakWidthLB( 0.3*kPeakWidth );
+	spec->SetBoundPeakWidthUB( 2.0*kPeakWidth );
+	spec->SetPeakEvaluationRange( 8.0 );
+
+	spec->SetNumberOfFits(1);
+	SFFit *fit = spec->GetFit(0);
+	fit->SetBGPolyOrder(1);
+	fit->SetFitLimitLB( lb );
+	fit->SetFitLimitUB( ub );
+	for ( unsigned int j = 0; j <= fit->GetBGPolyOrder(); ++j ){
+		fit->SetBGPoly( j, -1.0 );
+		fit->SetBGPolyLB( j, -1.0 );
+		fit->SetBGPolyUB( j, -1.0 );
+		fit->SetBGPolyFixed( j, false );
+	}
+
+	// Start a little way from the true means
+	for ( unsigned int i = 0; i < n_peaks; ++i ){
+		SFPeak *peak = new SFPeak();
+		peak->SetMean( sg.GetPeakMean(i) + 0.2*kPeakWidth );
+		if ( peak->GetMean() < spec->GetSeparationEnergy() )peak->SetBound();
+		else peak->SetUnbound();
+		spec->AddPeak( peak );
+	}
+
+	spec->SetNumberOfIntegrals(1);
+	SFSpectrumIntegral *integral = spec->GetIntegral(0);
+	integral->SetIntegralLB( 0.4*ub );
+	integral->SetIntegralUB( 0.6*ub );
+	integral->SetBackgroundFromCoordinates( false );
+	integral->SetBGPolyOrder( fit->GetBGPolyOrder() );
+	integral->SetParentFit( fit );
+
+	return spec;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Everything up to FitPeaks
+void PrepareFits( SFSpectrumFitter &sf, SFSpectrum *spec ){
+	sf.SetSpectrum( spec );
+	sf.SetNumberOfThreads(1);
+	sf.InitialiseSpectrumGuesses();
+	sf.GenerateInitialFits();
+	sf.SetFittingOptions();
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Parameters at the values of the guesses
+std::vector<double> GetGuessedParameters( SFFit *fit ){
+	std::vector<double> p( fit->GetNumberOfFitParameters() );
+	for ( unsigned int i = 0; i < p.size(); ++i ){
+		p[i] = fit->GetFitParameter(i).value;
+	}
+	return p;
+}
+///////////////////////////////////////////////////////////////////////////////
+void BM_GenerateTotalFitString( benchmark::State &state ){
+	SFSpectrum *spec = MakeSpectrum( state.range(0), 1000 );
+	SFSpectrumFitter sf;
+	PrepareFits( sf, spec );
+	SFFit *fit = spec->GetFit(0);
+
+	for ( auto _ : state ){
+		TString s = fit->GenerateTotalFitString(0);
+		benchmark::DoNotOptimize( s.Data() );
+	}
+	state.counters["parameters"] = fit->GetNumberOfFitParameters();
+	delete spec;
+}
+BENCHMARK( BM_GenerateTotalFitString )->ArgName("peaks")->RangeMultiplier(4)->Range( 5, 320 );
+///////////////////////////////////////////////////////////////////////////////
+// The compiled model, one bin at a time (as TF1::Eval and drawing use it)
+void BM_FitFunctionPerBin( benchmark::State &state ){
+	SFSpectrum *spec = MakeSpectrum( state.range(0), state.range(1) );
+	SFSpectrumFitter sf;
+	PrepareFits( sf, spec );
+	SFFit *fit = spec->GetFit(0);
+	SFFitFunction model( fit, 0 );
+	std::vector<double> p = GetGuessedParameters( fit );
+	const int n = spec->GetNumberOfBins();
+
+	for ( auto _ : state ){
+		for ( int i = 1; i <= n; ++i ){
+			benchmark::DoNotOptimize( model.Evaluate( spec->GetBinCentre(i), p.data() ) );
+		}
+	}
+	state.SetItemsProcessed( state.iterations()*n );
+	delete spec;
+}
+BENCHMARK( BM_FitFunctionPerBin )->ArgNames({ "peaks", "bins" })->Args({ 5, 1000 })->Args({ 20, 4000 })->Args({ 80, 16000 });
+///////////////////////////////////////////////////////////////////////////////
+// The vectorised model over the fit window, as the likelihood uses it
+void BM_FitKernelPerBin( benchmark::State &state ){
+	SFSpectrum *spec = MakeSpectrum( state.range(0), state.range(1) );
+	SFSpectrumFitter sf;
+	PrepareFits( sf, spec );
+	SFFit *fit = spec->GetFit(0);
+	std::vector<double> p = GetGuessedParameters( fit );
+	std::vector<double> x, y;
+	spec->GetBinArrays( fit->GetFitLimitLB(), fit->GetFitLimitUB(), x, y );
+	SFFitKernel kernel( SFFitFunction( fit, 0 ), x );
+	kernel.SetPeakRange( spec->GetPeakEvaluationRange() );
+	std::vector<double> mu( x.size() );
+
+	for ( auto _ : state ){
+		kernel.Evaluate( p.data(), mu.data() );
+		benchmark::DoNotOptimize( mu.data() );
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed( state.iterations()*x.size() );
+	delete spec;
+}
+BENCHMARK( BM_FitKernelPerBin )->ArgNames({ "peaks", "bins" })->Args({ 5, 1000 })->Args({ 20, 4000 })->Args({ 80, 16000 });
+///////////////////////////////////////////////////////////////////////////////
+// A new spectrum is fitted each time, but only FitPeaks is timed
+void BM_FitPeaks( benchmark::State &state ){
+	unsigned int parameters = 0;
+	SFSpectrumFitter sf;	// Outside the loop, so only FitPeaks is timed
+	for ( auto _ : state ){
+		state.PauseTiming();
+		SFSpectrum *spec = MakeSpectrum( state.range(0), state.range(1) );
+		PrepareFits( sf, spec );
+		parameters = spec->GetFit(0)->GetNumberOfFitParameters();
+		state.ResumeTiming();
+
+		sf.FitPeaks();
+
+		state.PauseTiming();
+		sf.SetSpectrum( nullptr );
+		delete spec;
+		state.ResumeTiming();
+	}
+	state.counters["parameters"] = parameters;
+}
+BENCHMARK( BM_FitPeaks )->ArgNames({ "peaks", "bins" })->Args({ 5, 1000 })->Args({ 20, 4000 })->Args({ 80, 16000 })->Unit( benchmark::kMillisecond );
+///////////////////////////////////////////////////////////////////////////////
+// Over the middle 20% of the spectrum, with the background from the fit
+void BM_CalculateIntegral( benchmark::State &state ){
+	SFSpectrum *spec = MakeSpectrum( 5, state.range(0) );
+	SFSpectrumFitter sf;
+	PrepareFits( sf, spec );
+	sf.FitPeaks();
+	sf.CalculateIntegrals();
+	SFSpectrumIntegral *integral = spec->GetIntegral(0);
+
+	for ( auto _ : state ){
+		integral->CalculateIntegral();
+		benchmark::DoNotOptimize( integral->GetIntegral() );
+	}
+	state.SetItemsProcessed( state.iterations()*state.range(0)/5 );
+	delete spec;
+}
+BENCHMARK( BM_CalculateIntegral )->ArgName("bins")->RangeMultiplier(4)->Range( 1000, 64000 );
+///////////////////////////////////////////////////////////////////////////////
+// Overlapping windows, each a tenth of the spectrum, sliding across it with the
+// background from the fit, as in a yield scan
+void BM_CalculateIntegralScan( benchmark::State &state ){
+	SFSpectrum *spec = MakeSpectrum( 5, 16000 );
+	SFSpectrumFitter sf;
+	PrepareFits( sf, spec );
+	sf.FitPeaks();
+	sf.CalculateIntegrals();
+	SFSpectrumIntegral *source = spec->GetIntegral(0);
+	const unsigned int order = source->GetBGPolyOrder();
+	const double ub = spec->GetFit(0)->GetFitLimitUB();
+
+	std::vector<SFSpectrumIntegral*> integrals( state.range(0) );
+	for ( unsigned int i = 0; i < integrals.size(); ++i ){
+		SFSpectrumIntegral *integral = new SFSpectrumIntegral();
+		integral->SetParentSpectrum( spec );
+		integral->SetBGPolyOrder( order );
+		for ( unsigned int j = 0; j <= order; ++j ){
+			integral->SetBGPoly( j, source->GetBGPoly(j) );
+			integral->SetBGPolyErr( j, source->GetBGPolyErr(j) );
+			for ( unsigned int k = 0; k < j; ++k ){
+				integral->SetBGCovMatrix( j, k, source->GetBGCovMatrix(j,k) );
+			}
+		}
+		integral->SetIntegralLB( 0.9*ub*i/integrals.size() );
+		integral->SetIntegralUB( integral->GetIntegralLB() + 0.1*ub );
+		integrals[i] = integral;
+	}
+
+	for ( auto _ : state ){
+		SFIntegralEngine engine;
+		engine.CalculateIntegrals( spec, integrals );
+		benchmark::DoNotOptimize( integrals.back()->GetIntegral() );
+	}
+	state.SetItemsProcessed( state.iterations()*integrals.size() );
+
+	for ( unsigned int i = 0; i < integrals.size(); ++i ){
+		delete integrals[i];
+	}
+	delete spec;
+}
+BENCHMARK( BM_CalculateIntegralScan )->ArgName("windows")->RangeMultiplier(8)->Range( 8, 4096 );
+///////////////////////////////////////////////////////////////////////////////
+void BM_WriteFits( benchmark::State &state ){
+	SFSpectrum *spec = MakeSpectrum( state.range(0), 1000 );
+	SFSpectrumFitter sf;
+	PrepareFits( sf, spec );
+	sf.FitPeaks();
+	sf.CalculateIntegrals();
+
+	TString file_name = Form( "%s/spectrum_fitter_benchmark_%d.dat", gSystem->TempDirectory(), gSystem->GetPid() );
+	SFFitWriter fw;
+	fw.SetFileLocation( file_name );
+	fw.SetSpectrum( spec );
+
+	for ( auto _ : state ){
+		fw.WriteFits();
+	}
+	std::remove( file_name.Data() );
+	delete spec;
+}
+BENCHMARK( BM_WriteFits )->ArgName("peaks")->RangeMultiplier(4)->Range( 5, 80 );
+///////////////////////////////////////////////////////////////////////////////
+int main( int argc, char *argv[] ){
+	// The fits are not expected to be perfect
+	MessageLogger *log = MessageLogger::GetInstance();
+	log->SetPrintConsoleLevel( MessageLogger::LevelError );
+
+	benchmark::Initialize( &argc, argv );
+	if ( benchmark::ReportUnrecognizedArguments( argc, argv ) )return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	delete log;
+	return 0;
+}
@@ -0,0 +1,50 @@
+// Fits every histogram selected in the config file with the same peak/fit/integral template
+#ifndef _BATCH_FITTER_HH_
+#define _BATCH_FITTER_HH_
+
+#include <vector>
+#include <TROOT.h>
+#include "FitWriter.hh"
+#include "InputFileProcessor.hh"
+#include "MessageLogger.hh"
+#include "Profiler.hh"
+#include "Spectrum.hh"
+#include "SpectrumDrawer.hh"
+#include "SpectrumFitter.hh"
+#include "ThreadPool.hh"
+
+class SFBatchFitter{
+public:
+	// Constructor/destructor
+	SFBatchFitter();
+	~SFBatchFitter();
+
+	// Create a spectrum for each histogram found by the InputFileProcessor. The
+	// first one has already been set up by InputFileProcessor::ProcessOptions, and
+	// stays owned by the caller.
+	void Initialise( SFSpectrum *first_spectrum );
+
+	// Fit all of the spectra (in parallel), then draw and write them (in order)
+	void FitSpectra();
+	void DrawSpectra();
+	void WriteFits();
+
+	// Getters
+	inline unsigned int GetNumberOfSpectra() const { return m_spec_list.size(); }
+	inline SFSpectrum* GetSpectrum( const unsigned int n ) const { return m_spec_list.at(n); }
+
+	// Setters
+	inline void SetInputFileProcessor( InputFileProcessor *ifp ){ m_ifp = ifp; }
+	inline void SetFitWriter( SFFitWriter *fw ){ m_fw = fw; }
+	inline void SetNumberOfThreads( const unsigned int n ){ m_number_of_threads = n; }
+
+private:
+	InputFileProcessor *m_ifp;
+	SFFitWriter *m_fw;
+	std::vector<SFSpectrum*> m_spec_list;
+	unsigned int m_number_of_threads;	// 0 = one per core
+
+	MessageLogger *log = MessageLogger::GetInstance();
+};
+
+#endif
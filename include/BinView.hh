@@ -0,0 +1,106 @@
+// Class to read the bins of a histogram or a buffer in their own type
+#ifndef _BIN_VIEW_HH_
+#define _BIN_VIEW_HH_
+
+#include <memory>
+#include <vector>
+#include <TArrayD.h>
+#include <TAxis.h>
+#include <TH1.h>
+#include <TMath.h>
+#include "MessageLogger.hh"
+
+// Points at the bin edges, contents and errors (if any) of a TH1C/S/I/F/D, or
+// of arrays held elsewhere, without copying them. The contents are kept in
+// their own type and only turned into doubles as they are read, so a TH1D or
+// a TH1I loses no precision. Bins are numbered as in ROOT (1 to N). The view
+// is only valid for as long as what backs it, unless it is given a share of it,
+// and must be remade if the histogram is rebinned. Other histograms (e.g.
+// TProfile) are copied.
+class SFBinView{
+public:
+	// Type of the bin contents
+	enum ContentType : unsigned char {
+		ContentChar = 0, ContentShort, ContentInt, ContentFloat, ContentDouble,
+		ContentUChar, ContentUShort, ContentUInt	// Only for buffers, e.g. raw files
+	};
+
+	// Constructors/destructor
+	SFBinView();
+	SFBinView( const TH1 *h );
+	SFBinView( const std::shared_ptr<const TH1> &h );	// Keeps h alive
+
+	// edges has n+1 entries, contents and errors (optional, not squared) have n, starting at bin 1
+	SFBinView( const int n, const double *edges, const void *contents, const ContentType type, const double *errors = nullptr );
+	SFBinView( const SFBinView &v ) = default;
+	~SFBinView();
+
+	// A copy points at the same bins and shares what holds them
+	SFBinView& operator=( const SFBinView &v ) = default;
+
+	// Getters
+	inline int GetNumberOfBins() const { return m_number_of_bins; }
+	inline ContentType GetContentType() const { return m_type; }
+	inline const double* GetEdges() const { return m_edges; }
+	inline bool HasErrors() const { return ( m_errors != nullptr ); }
+
+	inline double GetContent( const int i ) const {
+		switch ( m_type ){
+			case ContentChar: return ( (const char*)m_contents )[ i - m_first ];
+			case ContentShort: return ( (const short*)m_contents )[ i - m_first ];
+			case ContentInt: return ( (const int*)m_contents )[ i - m_first ];
+			case ContentFloat: return ( (const float*)m_contents )[ i - m_first ];
+			case ContentUChar: return ( (const unsigned char*)m_contents )[ i - m_first ];
+			case ContentUShort: return ( (const unsigned short*)m_contents )[ i - m_first ];
+			case ContentUInt: return ( (const unsigned int*)m_contents )[ i - m_first ];
+			default: return ( (const double*)m_contents )[ i - m_first ];
+		}
+	}
+
+	// The stored error, or the Poisson error if there is none
+	inline double GetError( const int i ) const {
+		if ( m_errors == nullptr )return TMath::Sqrt( TMath::Abs( GetContent(i) ) );
+		return ( m_errors_squared ? TMath::Sqrt( m_errors[ i - m_first ] ) : m_errors[ i - m_first ] );
+	}
+
+	// Keep what the view points into (e.g. a buffer) alive for as long as the view or any copy of it
+	inline void SetSource( const std::shared_ptr<const void> &source ){ m_source = source; }
+
+	// Contents of bins first to last, converted once for the whole range
+	void GetContents( const int first, const int last, double *y ) const;
+
+	// A TH1D copy of the bins, e.g. to draw (the caller owns it). nullptr if there are no bins
+	TH1D* MakeHistogram( const TString &name, const TString &title ) const;
+
+	static unsigned int GetContentSize( const ContentType type );
+
+private:
+	// Arrays the view has to hold itself
+	struct OwnArrays{
+		std::vector<double> edges;		// Equal bins have no edges stored in the histogram
+		std::vector<double> contents;	// Only for histograms that cannot be viewed
+		std::vector<double> errors;
+	};
+
+	int m_number_of_bins;
+	ContentType m_type;
+	const void *m_contents;			//! Points into the histogram or buffer
+	const double *m_edges;			//!
+	const double *m_errors;			//!
+	bool m_errors_squared;			// Errors from TH1::Sumw2 are squared
+	int m_first;					// Index of bin i is i - m_first (1 without an underflow bin)
+	std::shared_ptr<const OwnArrays> m_own;	// Shared by copies, so they copy no bins
+	std::shared_ptr<const void> m_source;	//! Keeps what the view points into alive (if given)
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	template <typename T>
+	static void ConvertContents( const T *contents, const int n, double *y ){
+		for ( int i = 0; i < n; ++i ){
+			y[i] = contents[i];
+		}
+		return;
+	}
+};
+
+#endif
@@ -14,6 +14,7 @@ public:
 
 	void Add( const TString flag, const TString message, TString* value );
 	void Add( const TString flag, const TString message, bool* value );
+	void Add( const TString flag, const TString message, int* value );
 
 	void CheckFlags(unsigned int argc, char* argv[]);
 
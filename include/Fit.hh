@@ -22,6 +22,26 @@ public:
 		FitParameterNULL = 0, FitParameterWidth, FitParameterWidthScale, FitParameterAmplitude, FitParameterMean, FitParameterBackground
 	};
 
+	// Everything needed to set up one fit parameter (see SFSpectrum::CalculateNumberOfPeaksAndFitParameters)
+	struct FitParameter{
+		FitParameterType type;
+		int peak;		// Peak number, or the order for background terms (-1 = common width)
+		double value;
+		double lb;
+		double ub;
+		bool fixed;
+	};
+
+	// How much work the minimiser did (see SFSpectrumFitter::FitWithAnalyticGradient).
+	// The status, covariance status and EDM are in the fit result.
+	struct FitTelemetry{
+		unsigned long evaluations;	// Likelihood values
+		unsigned long gradients;	// Likelihood gradients
+		unsigned int iterations;	// Migrad iterations (including the projected fit)
+		double time;				// Wall time (s)
+		bool cached;				// Result taken from the SFFitCache
+	};
+
 	// Constructor/destructor
 	SFFit();
 	~SFFit();
@@ -33,13 +53,12 @@ public:
 	TString GetBGInfoString() const;
 
 	TF1* GetIndividualFit( const unsigned int n) const;
-	FitParameterType GetFitParameterType(const unsigned int n) const;
 	double GetBGCovMatrix( unsigned int i, unsigned int j ) const;
 
 
 	// Setters
 	void SetIndividualFit(const unsigned int n, TF1* fit);
-	void SetFitParameterType(const unsigned int n, const FitParameterType type);
+	void SetFitParameter( const unsigned int n, const FitParameter &par );
 	void SetBGCovMatrix( unsigned int i, unsigned int j, const double val );
 
 	void SetNumberOfPeaks( const int n);
@@ -53,6 +72,7 @@ public:
 
 	inline TF1* GetFit() const { return m_fit; }
 	inline TFitResultPtr GetFitResultPtr() const { return m_fit_result; }
+	inline const FitTelemetry& GetTelemetry() const { return m_telemetry; }
 	inline double GetFitLimitLB() const { return m_fit_limit_lb; }
 	inline double GetFitLimitUB() const { return m_fit_limit_ub; }
 	
@@ -65,12 +85,23 @@ public:
 	inline bool IsBGPolyFixed( const unsigned int n ) const { return this->GetBGQuantity<bool>( n, m_bg_fixed ); }
 	inline int IsBGPolyLimited( const unsigned int n ) const { return this->GetBGQuantity<int>( n, m_bg_limit ); }
 
-	inline int GetPeakNumberMap( const unsigned int n ){ return m_parameter_number_to_peak_number_map.at(n); }
+	inline const FitParameter& GetFitParameter( const unsigned int n ) const { return m_parameter_layout[n]; }
+	inline const std::vector<FitParameter>& GetParameterLayout() const { return m_parameter_layout; }
+	inline FitParameterType GetFitParameterType( const unsigned int n ) const { return m_parameter_layout[n].type; }
 	inline int GetPeakNumber( const unsigned int n ){ return m_list_of_peak_numbers.at(n); }
 
+	// Position of a (spectrum) peak number in this fit's list of peaks, or -1 if it is not in this fit
+	inline int GetPeakIndex( const unsigned int peak_num ) const {
+		for ( unsigned int k = 0; k < m_list_of_peak_numbers.size(); ++k ){
+			if ( m_list_of_peak_numbers[k] == peak_num )return k;
+		}
+		return -1;
+	}
+
 	// Inline setters
 	inline void SetFit( TF1* fit ){ m_fit = fit; }
 	inline void SetFitResultPtr( TFitResultPtr r ){ m_fit_result = r; }
+	inline void SetTelemetry( const FitTelemetry &t ){ m_telemetry = t; }
 	inline void SetFitLimitLB( const double lb ){ m_fit_limit_lb = lb; }
 	inline void SetFitLimitUB( const double ub ){ m_fit_limit_ub = ub; }
 	
@@ -82,7 +113,6 @@ public:
 	inline void SetBGPolyLimited( const unsigned int n , const int val){ this->SetBGQuantity<int>( n, m_bg_limit, val ); }
 
 	inline void AddPeakNumber( const unsigned int n ){ m_list_of_peak_numbers.push_back(n); }
-	inline void SetPeakNumberMap( const unsigned int n, const unsigned int val ){ m_parameter_number_to_peak_number_map.at(n) = val; }
 
 	inline void SetParentSpectrum( SFSpectrum* spec ){ m_parent_spectrum = spec; }
 
@@ -97,14 +127,14 @@ private:
 	double m_fit_limit_lb;
 	double m_fit_limit_ub;
 
-	std::vector<FitParameterType> m_list_of_fit_parameter_types;
-	std::vector<unsigned int> m_parameter_number_to_peak_number_map;
+	std::vector<FitParameter> m_parameter_layout;	// One entry per fit parameter
 	std::vector<unsigned int> m_list_of_peak_numbers;
 
 	TF1 * m_fit;
 	std::vector<TF1*> m_fit_individual;
 
 	TFitResultPtr m_fit_result;
+	FitTelemetry m_telemetry;
 	SFSpectrum *m_parent_spectrum;
 	
 	unsigned int m_background_polynomial_level;
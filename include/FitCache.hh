@@ -0,0 +1,50 @@
+// Class to store fit results on disk, keyed by everything that goes into the fit
+#ifndef _FIT_CACHE_HH_
+#define _FIT_CACHE_HH_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <TF1.h>
+#include <TString.h>
+#include <TSystem.h>
+#include "FitResult.hh"
+#include "MessageLogger.hh"
+
+// A fit window is refitted only if its key changes. The key is a hash of the bin
+// slice and of the name, starting value, limits and fixed flag of every TF1
+// parameter, plus any fit options (e.g. the range each peak is evaluated over)
+// -- these are all the minimiser sees, so a config edit that touches one window
+// leaves the keys of the others as they were.
+class SFFitCache{
+public:
+	// Constructor/destructor
+	SFFitCache( const TString &directory );
+	~SFFitCache();
+
+	TString GetKey( const TF1 *fit_func, const std::vector<double> &x, const std::vector<double> &y, const TString &fit_options ) const;
+
+	// Returns nullptr if there is no usable result for this key
+	SFFitResult* Load( const TString &key, const TF1 *fit_func ) const;
+	void Save( const TString &key, const SFFitResult *result ) const;
+
+	// Getters
+	inline TString GetDirectory() const { return m_directory; }
+
+private:
+	TString m_directory;
+	static const unsigned int m_format_version = 1;	// Change this if the model or minimiser settings change
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	TString GetFileName( const TString &key ) const;
+	void AddToHash( uint64_t &hash, const void *data, const size_t size ) const;
+	void AddToHash( uint64_t &hash, const double x ) const;
+};
+
+#endif
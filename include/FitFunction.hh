@@ -0,0 +1,73 @@
+// Compiled multi-Gaussian + polynomial model, replacing the TFormula strings built by SFFit
+#ifndef _FIT_FUNCTION_HH_
+#define _FIT_FUNCTION_HH_
+
+#include <vector>
+#include <Math/IParamFunction.h>
+#include <TMath.h>
+#include "Fit.hh"
+#include "MessageLogger.hh"
+#include "Polynomial.hh"
+
+// Need to forward-declare this because SFFitFunction reads the parameter layout of the fit
+class SFFit;
+
+// Derives from the ROOT parametric gradient interface so that the fitter can use
+// the analytic parameter gradient rather than finite differences
+class SFFitFunction : public ROOT::Math::IParametricGradFunctionOneDim{
+public:
+	// Width modes (same as the modes in SFFit::GenerateGaussianString)
+	enum WidthMode : unsigned char {
+		WidthModeCommon = 0, WidthModeScaled, WidthModeFixed
+	};
+
+	// Constructor/destructor
+	SFFitFunction();
+	SFFitFunction( SFFit *fit, const bool is_individual_fit );
+	~SFFitFunction();
+
+	// Evaluate the model -- the first form is the signature expected by TF1
+	inline double operator()( const double *x, const double *p ) const { return this->Evaluate( x[0], p ); }
+	double Evaluate( const double x, const double *p ) const;
+	void ParameterGradient( double x, const double *p, double *grad ) const override;
+
+	// ROOT function interface
+	inline SFFitFunction* Clone() const override { return new SFFitFunction(*this); }
+	inline const double* Parameters() const override { return m_parameters.data(); }
+	inline void SetParameters( const double *p ) override { m_parameters.assign( p, p + m_number_of_parameters ); }
+	inline unsigned int NPar() const override { return m_number_of_parameters; }
+
+	// Getters
+	inline unsigned int GetNumberOfPeaks() const { return m_width_mode.size(); }
+	inline unsigned int GetNumberOfParameters() const { return m_number_of_parameters; }
+	inline unsigned int GetBGPolyOrder() const { return m_background_polynomial_level; }
+	inline unsigned int GetBGParameterIndex() const { return m_bg_index; }
+	inline WidthMode GetWidthMode( const unsigned int n ) const { return m_width_mode.at(n); }
+	inline unsigned int GetWidthIndex( const unsigned int n ) const { return m_width_index.at(n); }
+	inline unsigned int GetAmplitudeIndex( const unsigned int n ) const { return m_amplitude_index.at(n); }
+	inline unsigned int GetMeanIndex( const unsigned int n ) const { return m_mean_index.at(n); }
+	inline double GetSigma( const unsigned int i, const double *p ) const {
+		return ( m_width_mode[i] == WidthModeScaled ? p[ m_width_index[i] ]*p[0] : p[ m_width_index[i] ] );
+	}
+
+private:
+	// Parameter indices for each peak in the fit
+	std::vector<WidthMode> m_width_mode;
+	std::vector<unsigned int> m_width_index;
+	std::vector<unsigned int> m_amplitude_index;
+	std::vector<unsigned int> m_mean_index;
+
+	unsigned int m_bg_index;
+	unsigned int m_background_polynomial_level;
+	unsigned int m_number_of_parameters;
+	std::vector<double> m_parameters;
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	// Private functions
+	inline double DoEvalPar( double x, const double *p ) const override { return this->Evaluate( x, p ); }
+	double DoParameterDerivative( double x, const double *p, unsigned int ipar ) const override;
+	double DoDerivative( double x ) const override;
+};
+
+#endif
@@ -0,0 +1,55 @@
+// Vectorised evaluation of the fit model over all bins of a fit window
+#ifndef _FIT_KERNEL_HH_
+#define _FIT_KERNEL_HH_
+
+#include <algorithm>
+#include <vector>
+#include <TString.h>
+#include "FitFunction.hh"
+#include "MessageLogger.hh"
+#include "Polynomial.hh"
+
+// The inner loops are compiled for AVX-512, AVX2 and plain x86-64, and the best
+// version for the CPU is selected when the program starts (GCC function
+// multi-versioning). Other compilers and platforms only get the scalar loops.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define SF_KERNEL_CLONES __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define SF_KERNEL_CLONES
+#endif
+
+class SFFitKernel{
+public:
+	// Constructor/destructor
+	SFFitKernel( const SFFitFunction &model, const std::vector<double> &x );
+	~SFFitKernel();
+
+	// Model value in every bin: mu[i] = f( x[i] )
+	void Evaluate( const double *p, double *mu ) const;
+
+	// Gradient of sum_i w[i]*f( x[i] ) with respect to every parameter
+	void WeightedGradient( const double *p, const double *w, double *grad ) const;
+
+	// Each peak is only evaluated within +/- n sigma of its mean (0 = the whole window).
+	// The bin centres must be in increasing order.
+	inline void SetPeakRange( const double n ){ m_peak_range = n; }
+	inline double GetPeakRange() const { return m_peak_range; }
+
+	// Getters
+	inline unsigned int GetNumberOfBins() const { return m_x.size(); }
+	inline unsigned int GetNumberOfParameters() const { return m_model.GetNumberOfParameters(); }
+	inline const SFFitFunction& GetModel() const { return m_model; }
+	inline const double* GetBinCentres() const { return m_x.data(); }
+
+	static TString GetInstructionSet();
+
+private:
+	void GetPeakBins( const double mean, const double sigma, unsigned int &first, unsigned int &n ) const;
+
+	SFFitFunction m_model;
+	std::vector<double> m_x;
+	double m_peak_range;
+	MessageLogger *log = MessageLogger::GetInstance();
+};
+
+#endif
@@ -0,0 +1,64 @@
+// Class to read back the fit parameter files written by SFFitWriter, e.g. to warm-start a refit
+#ifndef _FIT_READER_HH_
+#define _FIT_READER_HH_
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <TMath.h>
+#include <TObjArray.h>
+#include <TObjString.h>
+#include <TString.h>
+#include "Fit.hh"
+#include "MessageLogger.hh"
+#include "Peak.hh"
+#include "Spectrum.hh"
+
+class SFFitReader{
+public:
+	// Fitted values of one peak ("P.nn" lines)
+	struct PeakResult{
+		double amplitude, amplitude_err;
+		double width, width_err;
+		double mean, mean_err;
+	};
+
+	// Fitted background of one fit ("Fit n" lines)
+	struct BackgroundResult{
+		std::vector<double> bg, bg_err;
+		bool is_valid;
+	};
+
+	// Everything written for one spectrum (one "# Spectrum:" block in batch mode)
+	struct SpectrumResult{
+		TString label;
+		std::vector<PeakResult> peaks;
+		std::vector<BackgroundResult> fits;
+	};
+
+	// Constructor/destructor
+	SFFitReader();
+	~SFFitReader();
+
+	// Read a fit parameter file
+	void ReadFile( const TString &file_location );
+
+	// Use the previous results as starting values for the peaks and fits in a
+	// spectrum, with the limits tightened to value +/- bound_scale*error
+	void WarmStartSpectrum( SFSpectrum *spec, const TString &label, const double bound_scale ) const;
+
+	// Getters
+	inline unsigned int GetNumberOfSpectra() const { return m_list_of_results.size(); }
+	const SpectrumResult* GetSpectrumResult( const TString &label ) const;
+
+private:
+	std::vector<SpectrumResult> m_list_of_results;
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	// Private functions
+	std::vector<TString> SplitLine( const TString &line ) const;
+	bool GetTightenedLimits( const double value, const double error, const double bound_scale, double &lb, double &ub ) const;
+};
+
+#endif
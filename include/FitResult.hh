@@ -0,0 +1,34 @@
+// TFitResult filled directly from a ROOT::Math::Minimizer, for fits that do not go through TH1::Fit
+#ifndef _FIT_RESULT_HH_
+#define _FIT_RESULT_HH_
+
+#include <iomanip>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <Math/Minimizer.h>
+#include <TF1.h>
+#include <TFitResult.h>
+#include "MessageLogger.hh"
+
+// Behaves exactly like the TFitResult returned by TH1::Fit( ..., "S" ), so that it can
+// be stored in a TFitResultPtr and read back by SFSpectrumFitter and SFFitWriter
+class SFFitResult : public TFitResult{
+public:
+	// Constructor/destructor
+	SFFitResult( const ROOT::Math::Minimizer &min, const TF1 *fit_func, const bool is_valid, const unsigned int number_of_bins );
+	SFFitResult( const TF1 *fit_func );
+	~SFFitResult();
+
+	// Plain-text copy of the result, at full precision (see SFFitCache),
+	// named so as not to hide TObject::Write and TObject::Read
+	void WriteText( std::ostream &out ) const;
+	bool ReadText( std::istream &in );
+
+private:
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	ClassDef(SFFitResult, 0);
+};
+
+#endif
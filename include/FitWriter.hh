@@ -25,8 +25,14 @@ public:
 	inline void SetFileLocation( const TString file_location ){ m_file_location = file_location; };
 	inline void SetSpectrum( SFSpectrum *spec ){ m_spec = spec; }
 
+	// Batch mode -- several spectra written one after another to the same file
+	inline void SetSpectrumLabel( const TString label ){ m_spectrum_label = label; }
+	inline void SetAppendMode( const bool b ){ m_append_mode = b; }
+
 private:
 	TString m_file_location;
+	TString m_spectrum_label;
+	bool m_append_mode;
 	std::ofstream m_output_file;
 	SFSpectrum *m_spec;
 	MessageLogger *log = MessageLogger::GetInstance();
@@ -34,6 +40,7 @@ private:
 
 	void WritePeakInformation( SFPeak* peak, unsigned int i );
 	void WriteIntegralInformation( SFSpectrumIntegral *integral, unsigned int i );
+	void WriteTelemetry( SFFit *fit );
 };
 
 #endif
\ No newline at end of file
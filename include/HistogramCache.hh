@@ -0,0 +1,89 @@
+// Class to keep ROOT files open between jobs, and the histograms read from them
+#ifndef _HISTOGRAM_CACHE_HH_
+#define _HISTOGRAM_CACHE_HH_
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <TClass.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TKey.h>
+#include <TMath.h>
+#include <TString.h>
+#include "BinView.hh"
+#include "MessageLogger.hh"
+
+// N.B. this is a singleton class, like MessageLogger. Each file is opened once,
+// and the names of its histograms are read from its keys once. The histograms
+// are shared and must not be changed (spectra view their bins through an
+// SFBinView, which keeps them alive, and only drawing makes a copy). When they
+// take up more than the memory limit, the least recently used are dropped from
+// the cache, although any still in use stay valid until they are released.
+// Files beyond the limit on open files are closed in the same order.
+class SFHistogramCache{
+public:
+	// Constructors and destructors
+	SFHistogramCache();
+	~SFHistogramCache();
+	SFHistogramCache( const SFHistogramCache& c ) = delete;
+
+	// Names (highest cycle only) of the histograms in a file. Returns false if it cannot be opened.
+	bool GetHistogramNames( const TString &file_name, std::vector<TString> &names );
+
+	// Any 1D histogram type, kept as it is. Returns nullptr if the file cannot be opened or has no such histogram.
+	std::shared_ptr<const TH1> GetHistogram( const TString &file_name, const TString &hist_name );
+
+	// Close every file and drop every histogram
+	void Clear();
+
+	// Setters and Getters
+	inline void SetMemoryLimit( const double mb ){ std::lock_guard<std::mutex> lock( m_mutex ); m_memory_limit = mb*1024*1024; }
+	inline void SetMaximumOpenFiles( const unsigned int n ){ std::lock_guard<std::mutex> lock( m_mutex ); m_maximum_open_files = n; }
+	inline double GetMemoryUsage() const { std::lock_guard<std::mutex> lock( m_mutex ); return m_memory_used/( 1024.0*1024.0 ); }
+	inline unsigned int GetNumberOfHistograms() const { std::lock_guard<std::mutex> lock( m_mutex ); return m_hists.size(); }
+	inline unsigned int GetNumberOfOpenFiles() const { std::lock_guard<std::mutex> lock( m_mutex ); return m_files.size(); }
+
+	// Singleton functions must be in class declaration
+	static SFHistogramCache* GetInstance(){
+		if ( m_instance_ptr == nullptr ){
+			m_instance_ptr = new SFHistogramCache();
+		}
+		return m_instance_ptr;
+	};
+
+private:
+	struct FileEntry{
+		TFile *file;
+		std::list<TString>::iterator used;	// Place in m_file_order
+	};
+
+	struct HistogramEntry{
+		std::shared_ptr<const TH1> hist;
+		double size;						// bytes
+		std::list<TString>::iterator used;	// Place in m_hist_order
+	};
+
+	static SFHistogramCache* m_instance_ptr;
+	std::map<TString,FileEntry> m_files;
+	std::map<TString,std::vector<TString>> m_names;		// Kept after the file is closed
+	std::map<TString,HistogramEntry> m_hists;			// "file:histogram"
+	std::list<TString> m_file_order;					// Most recently used first
+	std::list<TString> m_hist_order;
+	double m_memory_used;								// bytes
+	double m_memory_limit;								// bytes
+	unsigned int m_maximum_open_files;
+	mutable std::mutex m_mutex;	//! Jobs can run on several threads
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	// Private functions (the mutex must be held)
+	TFile* GetFile( const TString &file_name );
+	void CloseFiles( const unsigned int n );
+	void DropHistograms( const double limit );
+};
+
+#endif
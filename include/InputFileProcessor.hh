@@ -1,16 +1,30 @@
 #ifndef _INPUT_FILE_PROCESSOR_HH_
 #define _INPUT_FILE_PROCESSOR_HH_
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <vector>
+#include <glob.h>
+#include <TClass.h>
 #include <TEnv.h>
 #include <TFile.h>
-#include <TH1F.h>
+#include <TH1.h>
+#include <TKey.h>
+#include <TObjArray.h>
+#include <TObjString.h>
+#include <TRegexp.h>
 #include <TString.h>
+#include <TSystem.h>
 #include "Fit.hh"
+#include "FitCache.hh"
+#include "FitReader.hh"
 #include "FitWriter.hh"
+#include "HistogramCache.hh"
 #include "MessageLogger.hh"
 #include "Spectrum.hh"
 #include "SpectrumFitter.hh"
+#include "SpectrumLoader.hh"
 #include "SpectrumDrawer.hh"
 
 class InputFileProcessor{
@@ -31,18 +45,37 @@ public:
 	inline SFSpectrumFitter* GetSpectrumFitter() const { return m_sf; }
 	inline SFSpectrumDrawer* GetSpectrumDrawer() const { return m_sd; }
 	inline SFFitWriter* GetFitWriter() const { return m_fw; }
+	inline SFFitCache* GetFitCache() const { return m_fit_cache; }
 	inline TString GetFileLocation() const { return m_input_file_location; }
+	inline unsigned int GetNumberOfHistograms() const { return m_hist_list.size(); }
+	inline TString GetHistogramLabel( const unsigned int n ) const { return m_hist_label_list.at(n); }
 
 	// Other functions
 	void ProcessOptions();
+	void ProcessSpectrumOptions( const unsigned int n, SFSpectrum *spec );
+	void ProcessDrawerOptions( const unsigned int n, SFSpectrumDrawer *sd );
 
 private:
 	TString m_input_file_location;	// Location of config file for specifying options
+	TEnv *m_config;					// The options read from the config file
+	std::vector<SFBinView> m_hist_list;	// Bins of the spectra to be fitted, shared with SFHistogramCache or SFSpectrumLoader's buffers
+	std::vector<TString> m_hist_label_list;	// "file:histogram" for each histogram
+	std::vector<TString> m_hist_tag_list;	// Suffix for the output files of each histogram
 	SFSpectrum *m_spec;				// Pointer to the spectrum
 	SFSpectrumFitter *m_sf;			// Pointer to the spectrum fitter object
 	SFSpectrumDrawer *m_sd;			// Pointer to the spectrum drawer object
 	SFFitWriter *m_fw;				// Pointer to the fit writer object
+	SFFitReader *m_fit_reader;		// Previous results to warm-start from (if any)
+	SFFitCache *m_fit_cache;		// Fit results kept between runs (if any)
 	MessageLogger *log = MessageLogger::GetInstance();	// Pointer to the logger class
+
+	// Private functions
+	void FindHistograms();
+	std::vector<TString> MatchHistogramNames( const TString &file_name, const TString &pattern ) const;
+	std::vector<TString> ExpandFileNames( const std::vector<TString> &list ) const;
+	std::vector<TString> SplitList( const TString &s ) const;
+	void ProcessLoaderOptions( SFSpectrumLoader &loader ) const;
+	void LoadHistograms( const SFSpectrumLoader &loader, const std::vector<TString> &file_list, const bool binary );
 };
 
 
@@ -0,0 +1,43 @@
+// Class to calculate all of the integrals of a spectrum together
+#ifndef _INTEGRAL_ENGINE_HH_
+#define _INTEGRAL_ENGINE_HH_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <TMath.h>
+#include "MessageLogger.hh"
+#include "Polynomial.hh"
+#include "Spectrum.hh"
+#include "SpectrumIntegral.hh"
+
+// Integrals with the same background (e.g. all taken from one fit) are sorted by
+// their lower limits and grouped where they overlap. Each group sweeps its bins
+// once, keeping running sums of the background, its centroid moment and its
+// derivatives, so each window then only needs its two end bins. The counts come
+// from the spectrum's bin cache. An integral with a background of its own is
+// calculated on its own (SFSpectrumIntegral::CalculateIntegral), which gives the
+// same result.
+class SFIntegralEngine{
+public:
+	// Constructor/destructor
+	SFIntegralEngine();
+	~SFIntegralEngine();
+
+	void CalculateIntegrals( const SFSpectrum *spec, const std::vector<SFSpectrumIntegral*> &integrals );
+
+private:
+	// Running sums over the bins of a group: [0] background, [1] x*background, then the
+	// derivatives with respect to each background parameter. Entry i is the sum of the
+	// first i bins.
+	std::vector<std::vector<double>> m_cumulative;
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	static std::vector<double> GetBackgroundKey( const SFSpectrumIntegral *integral );
+
+	// Integrals sharing a background, sorted by LB, and overlapping
+	void CalculateGroup( const SFSpectrum *spec, const std::vector<SFSpectrumIntegral*> &group );
+};
+
+#endif
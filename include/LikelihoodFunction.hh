@@ -0,0 +1,55 @@
+// Binned Poisson likelihood of the fit model, evaluated with SFFitKernel
+#ifndef _LIKELIHOOD_FUNCTION_HH_
+#define _LIKELIHOOD_FUNCTION_HH_
+
+#include <vector>
+#include <Math/IFunction.h>
+#include <TMath.h>
+#include "FitFunction.hh"
+#include "FitKernel.hh"
+#include "MessageLogger.hh"
+
+// Returns the likelihood chi-squared, 2*sum( mu - y + y*ln(y/mu) ), so that an
+// error definition of 1 gives the usual likelihood errors and the minimum is
+// directly comparable to a chi-squared
+class SFLikelihoodFunction : public ROOT::Math::IMultiGradFunction{
+public:
+	// Constructor/destructor
+	SFLikelihoodFunction( const SFFitFunction &model, const std::vector<double> &x, const std::vector<double> &y );
+	~SFLikelihoodFunction();
+
+	// ROOT function interface
+	inline SFLikelihoodFunction* Clone() const override { return new SFLikelihoodFunction(*this); }
+	inline unsigned int NDim() const override { return m_kernel.GetNumberOfParameters(); }
+	void Gradient( const double *p, double *grad ) const override;
+	void FdF( const double *p, double &f, double *grad ) const override;
+
+	// See SFFitKernel::SetPeakRange
+	inline void SetPeakRange( const double n ){ m_kernel.SetPeakRange(n); }
+
+	// Getters
+	inline unsigned int GetNumberOfBins() const { return m_y.size(); }
+	inline double GetPeakRange() const { return m_kernel.GetPeakRange(); }
+	inline unsigned long GetNumberOfEvaluations() const { return m_number_of_evaluations; }
+	inline unsigned long GetNumberOfGradientEvaluations() const { return m_number_of_gradient_evaluations; }
+	double GetNegativeLogLikelihood( const double *p ) const;
+
+private:
+	SFFitKernel m_kernel;
+	std::vector<double> m_y;
+	double m_saturated;	// sum( y*ln(y) - y ), the likelihood chi2 offset
+	double m_log_factorial;	// sum( ln(y!) ) = sum( lgamma(y+1) )
+	mutable std::vector<double> m_mu;	// Scratch space for the model in each bin
+	mutable std::vector<double> m_w;	// Scratch space for the gradient weights
+	mutable unsigned long m_number_of_evaluations;	// Calls for the value (including FdF)
+	mutable unsigned long m_number_of_gradient_evaluations;	// Calls for the gradient (including FdF)
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	// Private functions
+	double CalculateModelAndWeights( const double *p, const bool calculate_weights ) const;
+	double DoEval( const double *p ) const override;
+	double DoDerivative( const double *p, unsigned int ipar ) const override;
+};
+
+#endif
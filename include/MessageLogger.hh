@@ -3,6 +3,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <vector>
 #include <TDatime.h>
 #include <TString.h>
@@ -102,6 +103,7 @@ private:
 	static MessageLogger* m_instance_ptr;
 	Level m_print_console_level;
 	Level m_print_file_level;
+	mutable std::mutex m_mutex;	//! Fits can run on several threads (see SFThreadPool)
 
 	void GeneralMessage( const TString message, const Level level ) const;
 	TString GetTime( const int level ) const;
@@ -0,0 +1,41 @@
+// Class to find peaks in a histogram, to give the fits better starting values
+#ifndef _PEAK_FINDER_HH_
+#define _PEAK_FINDER_HH_
+
+#include <vector>
+#include <TMath.h>
+#include "MessageLogger.hh"
+
+// The bins are smoothed with the (negative) second derivative of a Gaussian of the
+// expected peak width. Flat and linear backgrounds cancel, so every local maximum
+// that is significant given the Poisson errors of the bins is taken as a peak.
+class SFPeakFinder{
+public:
+	struct Candidate{
+		double mean;
+		double width;			// Gaussian sigma
+		double amplitude;		// Height above the local background
+		double significance;	// Of the smoothed second derivative
+	};
+
+	// Constructor/destructor
+	SFPeakFinder();
+	~SFPeakFinder();
+
+	// Bin centres and contents of an evenly binned histogram -- the width is in x units
+	void Search( const std::vector<double> &x, const std::vector<double> &y, const double width_guess, const double threshold );
+
+	// Getters
+	inline unsigned int GetNumberOfCandidates() const { return m_candidates.size(); }
+	inline const Candidate& GetCandidate( const unsigned int n ) const { return m_candidates.at(n); }
+	int FindNearestCandidate( const double x, const double max_distance ) const;
+
+private:
+	std::vector<Candidate> m_candidates;	// In order of increasing mean
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	double EstimateWidth( const std::vector<double> &y, const int peak_bin, const double background, const double amplitude, const int max_distance ) const;
+};
+
+#endif
@@ -0,0 +1,64 @@
+// Background polynomial c[0] + c[1]*x + ... + c[N]*x^N with the order fixed at compile time
+#ifndef _POLYNOMIAL_HH_
+#define _POLYNOMIAL_HH_
+
+// Orders above this are not specialised and take the order at run time instead
+const unsigned int kSFPolynomialMaxOrder = 3;
+const unsigned int kSFPolynomialAnyOrder = kSFPolynomialMaxOrder + 1;
+
+// N = 0...kSFPolynomialMaxOrder: the loops have a constant length and unroll.
+// The run-time order is accepted by every function so that the same code can
+// call either form (see SFPolynomialDispatch).
+template <unsigned int N>
+struct SFPolynomial{
+	static inline unsigned int Order( const unsigned int ){ return N; }
+
+	// Horner's method
+	static inline double Value( const double *c, const double x, const unsigned int order ){
+		double sum = 0.0;
+		for ( int i = Order(order); i >= 0; --i ){
+			sum = sum*x + c[i];
+		}
+		return sum;
+	}
+
+	// d/dx
+	static inline double Derivative( const double *c, const double x, const unsigned int order ){
+		double sum = 0.0;
+		for ( int i = Order(order); i >= 1; --i ){
+			sum = sum*x + i*c[i];
+		}
+		return sum;
+	}
+
+	// Integral from a to b
+	static inline double Integral( const double *c, const double a, const double b, const unsigned int order ){
+		double sum_a = 0.0;
+		double sum_b = 0.0;
+		for ( int i = Order(order); i >= 0; --i ){
+			sum_a = sum_a*a + c[i]/( i + 1 );
+			sum_b = sum_b*b + c[i]/( i + 1 );
+		}
+		return sum_b*b - sum_a*a;
+	}
+};
+
+// Any other order
+template <>
+inline unsigned int SFPolynomial<kSFPolynomialAnyOrder>::Order( const unsigned int order ){ return order; }
+
+// Calls f( SFPolynomial<order>() ), e.g.
+// SFPolynomialDispatch( order, [&]( auto poly ){ y = poly.Value( c, x, order ); } );
+template <typename F>
+inline void SFPolynomialDispatch( const unsigned int order, F &&f ){
+	switch ( order ){
+		case 0: f( SFPolynomial<0>() ); break;
+		case 1: f( SFPolynomial<1>() ); break;
+		case 2: f( SFPolynomial<2>() ); break;
+		case 3: f( SFPolynomial<3>() ); break;
+		default: f( SFPolynomial<kSFPolynomialAnyOrder>() ); break;
+	}
+	return;
+}
+
+#endif
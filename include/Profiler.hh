@@ -0,0 +1,84 @@
+// Wall and CPU time spent in each stage of the program, written out as JSON
+#ifndef _PROFILER_HH_
+#define _PROFILER_HH_
+
+#include <ctime>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <TString.h>
+#include "MessageLogger.hh"
+
+// N.B. this is a singleton class, like MessageLogger. Timers nest within the
+// timer that is running on the same thread, and timers with the same name and
+// parent are added together. Nothing is recorded unless the profiler is enabled.
+class SFProfiler{
+public:
+	// Times a scope, e.g. { SFProfiler::Timer t("FitPeaks"); ... }
+	class Timer{
+	public:
+		Timer( const TString &name );
+		Timer( const TString &name, const int parent );
+		~Timer();
+		Timer( const Timer& t ) = delete;
+
+	private:
+		bool m_running;
+	};
+
+	// Constructors and destructors
+	SFProfiler();
+	~SFProfiler();
+	SFProfiler( const SFProfiler& p ) = delete;
+
+	// Start a timer within the timer running on this thread, or within parent
+	void Start( const TString &name );
+	void Start( const TString &name, const int parent );
+	void Stop();
+
+	// The timer running on this thread (-1 if none), to pass to other threads as a parent
+	int GetCurrentTimer() const;
+
+	void WriteJSON( const TString &file_name ) const;
+
+	// Setters and Getters
+	inline void SetEnabled( const bool b ){ m_enabled = b; }
+	inline bool IsEnabled() const { return m_enabled; }
+
+	// Singleton functions must be in class declaration
+	static SFProfiler* GetInstance(){
+		if ( m_instance_ptr == nullptr ){
+			m_instance_ptr = new SFProfiler();
+		}
+		return m_instance_ptr;
+	};
+
+private:
+	struct Record{
+		TString name;
+		int parent;				// -1 = top level
+		unsigned long calls;
+		double wall;			// s
+		double cpu;				// s (of the thread that ran the timer)
+	};
+
+	static SFProfiler* m_instance_ptr;
+	bool m_enabled;
+	std::chrono::steady_clock::time_point m_start_time;
+	std::vector<Record> m_records;
+	std::map< std::pair<int,TString>, int > m_record_index;	// (parent, name) -> record
+	mutable std::mutex m_mutex;	//! Timers can run on several threads (see SFThreadPool)
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	// Private functions
+	double GetWallTime() const;
+	double GetThreadCPUTime() const;
+	void WriteRecord( std::ofstream &f, const int n, const TString &indent ) const;
+	TString EscapeJSON( const TString &s ) const;
+};
+
+#endif
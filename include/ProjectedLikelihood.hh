@@ -0,0 +1,70 @@
+// Likelihood of the nonlinear fit parameters, with the linear ones solved for at each step
+#ifndef _PROJECTED_LIKELIHOOD_HH_
+#define _PROJECTED_LIKELIHOOD_HH_
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <Math/IFunction.h>
+#include <TMath.h>
+#include "FitFunction.hh"
+#include "LikelihoodFunction.hh"
+#include "MessageLogger.hh"
+
+// The amplitudes and background terms enter the model linearly, so for given
+// means and widths their best values follow from a small bounded Newton solve
+// of the Poisson likelihood (variable projection). The minimiser then only sees
+// the means, the common width and the width scales. At the inner solution the
+// likelihood is stationary in the linear parameters, so the gradient of the
+// projected likelihood is the gradient of the full one in the nonlinear ones.
+class SFProjectedLikelihood : public ROOT::Math::IMultiGradFunction{
+public:
+	// Constructor/destructor -- p holds the starting values of all parameters, and lb
+	// and ub their limits (equal for fixed parameters, infinite if there are none)
+	SFProjectedLikelihood( const SFLikelihoodFunction &likelihood, const SFFitFunction &model, const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &p, const std::vector<double> &lb, const std::vector<double> &ub );
+	~SFProjectedLikelihood();
+
+	// ROOT function interface
+	inline SFProjectedLikelihood* Clone() const override { return new SFProjectedLikelihood(*this); }
+	inline unsigned int NDim() const override { return m_nonlinear_index.size(); }
+	void Gradient( const double *q, double *grad ) const override;
+	void FdF( const double *q, double &f, double *grad ) const override;
+
+	// All of the parameters for the nonlinear parameters q
+	void GetParameters( const double *q, double *p ) const;
+
+	// Getters
+	inline unsigned int GetParameterIndex( const unsigned int n ) const { return m_nonlinear_index.at(n); }
+	inline unsigned int GetNumberOfLinearParameters() const { return m_linear_index.size(); }
+
+private:
+	const SFLikelihoodFunction *m_likelihood;
+	SFFitFunction m_model;
+	std::vector<double> m_x;
+	std::vector<double> m_y;
+	std::vector<unsigned int> m_linear_index;		// Amplitudes, then background terms
+	std::vector<unsigned int> m_nonlinear_index;	// Everything else
+	std::vector<double> m_lb;	// Limits of the linear parameters
+	std::vector<double> m_ub;
+
+	// Value of each linear term (unit amplitude) in every bin, and the bins where it is not zero
+	mutable std::vector<double> m_basis;
+	mutable std::vector<unsigned int> m_first_bin;
+	mutable std::vector<unsigned int> m_last_bin;
+
+	mutable std::vector<double> m_p;		// The last solution -- the next inner solve starts here
+	mutable std::vector<double> m_last_q;
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	// Private functions
+	void SolveLinearParameters( const double *q ) const;
+	void CalculatePeakBasis() const;
+	double CalculateObjective( const std::vector<double> &c, std::vector<double> &mu ) const;
+	bool SolveNewtonStep( std::vector<double> &h, std::vector<double> &b, const unsigned int n ) const;
+	double DoEval( const double *q ) const override;
+	double DoDerivative( const double *q, unsigned int ipar ) const override;
+};
+
+#endif
@@ -7,6 +7,7 @@
 #pragma link C++ class MessageLogger+;
 #pragma link C++ class InputFileProcessor+;
 #pragma link C++ class SFFit+;
+#pragma link C++ class SFFitResult+;
 #pragma link C++ class SFPeak+;
 #pragma link C++ class SFSpectrum+;
 #pragma link C++ class SFSpectrumDrawer+;
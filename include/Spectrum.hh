@@ -2,13 +2,16 @@
 #ifndef _SPECTRUM_HH_
 #define _SPECTRUM_HH_
 
+#include <algorithm>
+#include <memory>
 #include <vector>
-#include <TH1F.h>
+#include <TH1.h>
 #include <TF1.h>
 #include <TFitResult.h>
 #include <TFitResultPtr.h>
 #include <TMath.h>
 #include <TObject.h>
+#include "BinView.hh"
 #include "Fit.hh"
 #include "MessageLogger.hh"
 #include "Peak.hh"
@@ -32,7 +35,8 @@ public:
 	~SFSpectrum();
 
 	// Getters
-	inline TH1F* GetHist() const { return m_hist; }
+	inline const SFBinView& GetBinView() const { return m_view; }
+	inline const TString& GetHistName() const { return m_hist_name; }
 	inline SFPeak* GetPeak( const int n ) const {
 		if ( n < 0 || n > (int)m_list_of_peaks.size() )return nullptr;
 		return m_list_of_peaks.at(n);
@@ -58,17 +62,26 @@ public:
 	inline double GetGuessAmplitudeFractionLB() const { return m_guess_amplitude_fraction_lb; }
 	inline double GetGuessAmplitudeFractionUB() const { return m_guess_amplitude_fraction_ub; }
 	inline double GetGuessMeanHalfWidth() const { return m_guess_mean_half_width; }
+	inline bool HasPeakSearch() const { return m_peak_search; }
+	inline double GetPeakSearchThreshold() const { return m_peak_search_threshold; }
+	inline double GetPeakEvaluationRange() const { return m_peak_evaluation_range; }
+	inline bool UsesVariableProjection() const { return m_variable_projection; }
+	inline double GetFitClusterSeparation() const { return m_fit_cluster_separation; }
+	inline bool HasFitClusterJointWidth() const { return m_fit_cluster_joint_width; }
 	
 	inline double GetBoundPeakWidth() const { return m_bound_width; }
 	inline double GetBoundPeakWidthLB() const { return m_bound_width_lb; }
 	inline double GetBoundPeakWidthUB() const { return m_bound_width_ub; }
 	inline bool HasFixedBoundPeakWidth() const { return m_bound_width_fixed; }
+	inline bool IsWarmStarted() const { return m_warm_start; }
 
-	// Setters
-	inline void SetHist( TH1F* h ){ m_hist = h; }
+	// Setters. The spectrum shares the bins (e.g. with SFHistogramCache) and never changes them
+	void SetHist( const std::shared_ptr<const TH1> &h );
+	void SetBinView( const SFBinView &view, const TString &name );
 	inline void SetSeparationEnergy( const double x ){ m_separation_energy = x; }
 	void SetNumberOfFits( const int n );
 	void SetNumberOfIntegrals( const int n );
+	void ReplaceFit( const unsigned int n, const std::vector<SFFit*> &fits );
 
 	inline void SetGuessWidth( const double x ){ m_guess_width = x; }
 	inline void SetGuessWidthLB( const double x ){ m_guess_width_lb = x; }
@@ -76,30 +89,65 @@ public:
 	inline void SetGuessAmplitudeFractionLB( const double x ){ m_guess_amplitude_fraction_lb = x; }
 	inline void SetGuessAmplitudeFractionUB( const double x ){ m_guess_amplitude_fraction_ub = x; }
 	inline void SetGuessMeanHalfWidth( const double x ){ m_guess_mean_half_width = x; }
+	inline void SetPeakSearch( const bool x ){ m_peak_search = x; }
+	inline void SetPeakSearchThreshold( const double x ){ m_peak_search_threshold = x; }
+	inline void SetPeakEvaluationRange( const double x ){ m_peak_evaluation_range = x; }
+	inline void SetVariableProjection( const bool x ){ m_variable_projection = x; }
+	inline void SetFitClusterSeparation( const double x ){ m_fit_cluster_separation = x; }
+	inline void SetFitClusterJointWidth( const bool x ){ m_fit_cluster_joint_width = x; }
 	
 	inline void SetBoundPeakWidth( const double x ){ m_bound_width = x; }
 	inline void SetBoundPeakWidthLB( const double x ){ m_bound_width_lb = x; }
 	inline void SetBoundPeakWidthUB( const double x ){ m_bound_width_ub = x; }
 	inline void SetFixedBoundPeakWidth( const bool x ){ m_bound_width_fixed = x; }
+	inline void SetWarmStart( const bool x ){ m_warm_start = x; }
 
 
 	// Other functions
 	void AddPeak( SFPeak* p );
 	int GetNumberOfPeaksInRange( double lb, double ub ) const;
+	void GetBinArrays( const double lb, const double ub, std::vector<double> &x, std::vector<double> &y ) const;
+
+	// A copy of the bins to draw or change (the caller owns it)
+	inline TH1* MakeHist() const { return m_view.MakeHistogram( m_hist_name, m_hist_name ); }
+
+	// Bin cache, built by SetHist or SetBinView. Bins are numbered as in ROOT, so
+	// FindBin gives 0 below the histogram and N+1 above it.
+	int FindBin( const double x ) const;
+	inline int GetNumberOfBins() const { return m_view.GetNumberOfBins(); }
+	inline double GetBinLowEdge( const int i ) const { return m_bin_edges[i-1]; }
+	inline double GetBinUpEdge( const int i ) const { return m_bin_edges[i]; }
+	inline double GetBinCentre( const int i ) const { return 0.5*( m_bin_edges[i-1] + m_bin_edges[i] ); }
+	inline double GetBinWidth( const int i ) const { return m_bin_edges[i] - m_bin_edges[i-1]; }
+	inline double GetBinContent( const int i ) const { return m_view.GetContent(i); }
+	inline double GetBinError( const int i ) const { return m_view.GetError(i); }
+
+	// Sum of x^k times the counts below x (k = 0, 1 or 2), where x is the bin centre. Part
+	// of a bin counts in proportion to how much of it is below x.
+	double GetCountsBelow( const double x, const unsigned int k = 0 ) const;
+	inline double GetCountsInRange( const double lb, const double ub, const unsigned int k = 0 ) const { return GetCountsBelow( ub, k ) - GetCountsBelow( lb, k ); }
 	void CalculateNumberOfPeaksAndFitParameters();
+	void UpdateFitParameterValues();
 
 private:
-	// Hist and fit pointers
-	TH1F* m_hist;
+	// Hist name and fit pointers
+	TString m_hist_name;
 	std::vector <SFPeak*> m_list_of_peaks;
 	std::vector <SFFit*> m_list_of_fits;
 	std::vector <SFSpectrumIntegral*> m_list_of_integrals;
 
+	// Bin cache
+	SFBinView m_view;										//! Bins of the histogram in their own type, shared with whatever holds them
+	const double *m_bin_edges;								//! Lower edge of bin i at i-1, upper edge of the last bin at the end
+	std::vector<std::vector<double>> m_cumulative_counts;	// [k][i] = sum of x^k times the counts in bins 1 to i
+	double m_inverse_bin_width;								// 0 if the bins are not all the same width
+
 	double m_separation_energy;
 	double m_bound_width;
 	double m_bound_width_lb;
 	double m_bound_width_ub;
 	bool m_bound_width_fixed;
+	bool m_warm_start;	// Guesses come from a previous fit (see SFFitReader)
 
 	double m_guess_width;
 	double m_guess_width_lb;
@@ -107,9 +155,19 @@ private:
 	double m_guess_amplitude_fraction_lb;
 	double m_guess_amplitude_fraction_ub;
 	double m_guess_mean_half_width;
+	bool m_peak_search;					// Seed the peaks from SFPeakFinder
+	double m_peak_search_threshold;		// Significance needed to count as a peak
+	double m_peak_evaluation_range;		// Peaks are only fitted within this many sigma of the mean (0 = whole fit)
+	bool m_variable_projection;			// Solve for the amplitudes and background inside the minimiser
+	double m_fit_cluster_separation;	// Split fits where peaks are this many widths apart (0 = never)
+	bool m_fit_cluster_joint_width;		// Refit with one bound peak width shared by all fits
 
 	MessageLogger *log = MessageLogger::GetInstance();
 
+	// Private functions
+	void SetFitParameterValues( SFFit *fit );
+	void UpdateBinCache();
+
 	ClassDef(SFSpectrum, 0);
 };
 
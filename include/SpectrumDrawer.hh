@@ -90,6 +90,7 @@ private:
 	static const std::vector<TString> m_file_formats;
 
 	SFSpectrum *m_spec;
+	TH1 *m_hist;	// Copy of the spectrum's bins to format and draw (they are shared, so cannot be changed)
 	TString m_print_file_name;
 	std::vector<bool> m_file_format_select;
 	std::vector<TPolyLine*> m_peak_marker_triangle;
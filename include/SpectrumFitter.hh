@@ -1,13 +1,29 @@
 #ifndef _SPECTRUM_FITTER_HH_
 #define _SPECTRUM_FITTER_HH_
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
 #include <vector>
+#include <Math/Factory.h>
+#include <Math/Minimizer.h>
 #include <TCanvas.h>
 #include <TMath.h>
+#include <TROOT.h>
 #include <TString.h>
 #include "Fit.hh"
+#include "FitCache.hh"
+#include "FitFunction.hh"
+#include "FitResult.hh"
+#include "IntegralEngine.hh"
+#include "LikelihoodFunction.hh"
 #include "MessageLogger.hh"
+#include "PeakFinder.hh"
+#include "Profiler.hh"
+#include "ProjectedLikelihood.hh"
 #include "Spectrum.hh"
+#include "ThreadPool.hh"
 
 class SFSpectrumFitter{
 public:
@@ -25,19 +41,33 @@ public:
 
 	// Getters
 	inline SFSpectrum* GetSpectrum(){ return m_spec; }
+	inline unsigned int GetNumberOfThreads() const { return m_number_of_threads; }
+	inline SFFitCache* GetFitCache() const { return m_fit_cache; }
 
 	// Setters
 	inline void SetSpectrum( SFSpectrum* s){ m_spec = s; }
+	inline void SetNumberOfThreads( const unsigned int n ){ m_number_of_threads = n; }
+	inline void SetFitCache( SFFitCache *c ){ m_fit_cache = c; }
 
 private:
 	SFSpectrum *m_spec;
+	unsigned int m_number_of_threads;	// 0 = one per core
+	SFFitCache *m_fit_cache;			// Results of earlier runs (not owned, nullptr = always fit)
 
 	// Private FUNCTIONS
 	MessageLogger *log = MessageLogger::GetInstance();
+	void SeedPeaksFromSearch();
+	void SplitFitsIntoClusters( const double bound_width );
+	void FitAllWindows();
+	void FitWithJointBoundPeakWidth();
 	void CheckForFitParameterGuessErrors();
 	void CheckForFitParameterValueErrors( SFFit* fit );
 	void UpdateSpectrumWithFitParameters( SFFit* fit );
 	int IsParameterAtLimit( int par_num, TFitResultPtr r );
+	TFitResultPtr FitWithAnalyticGradient( SFFit* fit );
+	void LogTelemetry( SFFit *fit, const unsigned int n );
+	unsigned int FindProjectedMinimum( SFFit *fit, const SFLikelihoodFunction &likelihood, const SFFitFunction &model, const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &lb, const std::vector<double> &ub, std::vector<double> &p );
+	void SetMinimizerVariable( ROOT::Math::Minimizer *minimizer, const unsigned int n, const TString &name, const double value, const double lb, const double ub );
 	
 };
 
@@ -0,0 +1,93 @@
+// Class to make synthetic spectra of Gaussian peaks on a background, with a config file to fit them
+#ifndef _SPECTRUM_GENERATOR_HH_
+#define _SPECTRUM_GENERATOR_HH_
+
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <TH1D.h>
+#include <TMath.h>
+#include <TRandom3.h>
+#include <TString.h>
+#include "MessageLogger.hh"
+
+// The peaks are evenly spaced (give or take a little jitter) with random areas.
+// Each bin is filled with a Poisson number of counts about its expected content,
+// which is integrated over the bin, so the time taken does not depend on the
+// number of counts. The same seed always gives the same spectrum.
+class SFSpectrumGenerator{
+public:
+	// How the peak width depends on x, relative to the width in the middle of the range
+	enum WidthModel : unsigned char {
+		WidthConstant = 0, WidthSqrt, WidthLinear
+	};
+
+	// Shape of the background across the range
+	enum BackgroundShape : unsigned char {
+		BackgroundFlat = 0, BackgroundLinear, BackgroundExponential
+	};
+
+	// Constructor/destructor
+	SFSpectrumGenerator();
+	~SFSpectrumGenerator();
+
+	// Place the peaks -- call again after changing any of the settings
+	void GeneratePeaks();
+
+	// The caller owns the histogram, a TH1D so counts above 2^24 stay exact.
+	// Histograms with a different noise index have the same peaks but
+	// independent counts
+	TH1D* GenerateHistogram( const TString &name, const unsigned int noise_index = 0 ) const;
+
+	// Config file for spectrum_fitter, with the true peak parameters as comments
+	void WriteConfigFile( const TString &file_name, const TString &root_file_name, const TString &hist_name ) const;
+
+	// Names used on the command line ("const", "sqrt", "linear" and "flat", "linear", "exp")
+	static bool GetWidthModel( const TString &s, WidthModel &model );
+	static bool GetBackgroundShape( const TString &s, BackgroundShape &shape );
+
+	// Setters
+	inline void SetNumberOfPeaks( const unsigned int n ){ m_number_of_peaks = n; }
+	inline void SetNumberOfBins( const unsigned int n ){ m_number_of_bins = n; }
+	inline void SetRange( const double lb, const double ub ){ m_lb = lb; m_ub = ub; }
+	inline void SetCounts( const double n ){ m_counts = n; }
+	inline void SetBackgroundFraction( const double f ){ m_background_fraction = f; }
+	inline void SetWidth( const double w ){ m_width = w; }
+	inline void SetWidthModel( const WidthModel m ){ m_width_model = m; }
+	inline void SetBackgroundShape( const BackgroundShape s ){ m_background_shape = s; }
+	inline void SetSeed( const unsigned int s ){ m_seed = s; }
+
+	// Getters
+	inline unsigned int GetNumberOfPeaks() const { return m_mean.size(); }
+	inline unsigned int GetNumberOfBins() const { return m_number_of_bins; }
+	inline double GetPeakMean( const unsigned int n ) const { return m_mean.at(n); }
+	inline double GetPeakWidth( const unsigned int n ) const { return m_sigma.at(n); }
+	inline double GetPeakArea( const unsigned int n ) const { return m_area.at(n); }
+	double GetWidthAtX( const double x ) const;
+
+private:
+	unsigned int m_number_of_peaks;
+	unsigned int m_number_of_bins;
+	double m_lb;
+	double m_ub;
+	double m_counts;				// Expected number of counts in the whole histogram
+	double m_background_fraction;	// Of m_counts
+	double m_width;					// Gaussian sigma in the middle of the range (<= 0 = chosen from the peak spacing)
+	WidthModel m_width_model;
+	BackgroundShape m_background_shape;
+	unsigned int m_seed;
+
+	double m_centre_width;			// m_width, or the width chosen by GeneratePeaks
+	std::vector<double> m_mean;
+	std::vector<double> m_sigma;
+	std::vector<double> m_area;
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	// Fraction of the background below x
+	double GetBackgroundCumulative( const double x ) const;
+	double GetMinimumWidth() const;
+	double GetMaximumWidth() const;
+};
+
+#endif
@@ -10,6 +10,7 @@
 #include <TString.h>
 #include "MessageLogger.hh"
 #include "Fit.hh"
+#include "Polynomial.hh"
 #include "Spectrum.hh"
 
 // Need to forward-declare this because SFSpectrumIntegral refers to parent spectrum...
@@ -27,6 +28,33 @@ public:
 	void CalculateIntegral();
 	TString GetStatus();
 
+	// Sets the integral, centroid and their errors from the sums over the window (see SFIntegralEngine)
+	void SetIntegralFromSums( const double counts, const double sum_xy, const double sum_xxy, const double bg_integral, const double bg_sum_x, const std::vector<double> &bg_gradient );
+
+	// Background in counts between x1 and x2 in one bin, where it is y1 and y2. The background is
+	// integrated exactly, except where it is above the bin content: there the content is taken
+	// instead (which removes it from the integral). Neither depends on the background parameters
+	// where they meet, so only the parts below the content add to the gradient.
+	template <typename P>
+	double GetBackgroundInBin( P poly, const double x1, const double x2, const double y1, const double y2, const double content, const double width, double *gradient ) const {
+		// Line below histogram...add no background
+		if ( y1 <= 0 && y2 <= 0 )return 0.0;
+
+		// Line above histogram...no centroid contribution
+		if ( content < y1 && content < y2 )return content*( x2 - x1 )/width;
+
+		// Passes up or down through the top of the bin
+		if ( content > y1 && content <= y2 ){
+			double x3 = FindBackgroundXForGivenY( content, x1, x2 );
+			return this->IntegrateBackground( poly, x1, x3, width, gradient ) + content*( x2 - x3 )/width;
+		}
+		if ( content <= y1 && content > y2 ){
+			double x3 = FindBackgroundXForGivenY( content, x1, x2 );
+			return content*( x3 - x1 )/width + this->IntegrateBackground( poly, x3, x2, width, gradient );
+		}
+		return this->IntegrateBackground( poly, x1, x2, width, gradient );
+	}
+
 	// Getters
 	inline SFSpectrum* GetSpectrum() const { return m_parent_spectrum; }
 	inline SFFit* GetFit() const { return m_parent_fit; }
@@ -84,8 +112,22 @@ private:
 	inline bool IsGoodBackgroundNumber( const unsigned int n ) const { return ( n >= 0 && n < m_background_polynomial_level + 1 ); }
 	double GetBackgroundAtX( const double x ) const;
 	double GetBackgroundAtXError( const double x ) const;
+	double GetBackgroundVariance( const std::vector<double> &gradient ) const;
 	double GetBackgroundDerivativeAtX( const double x ) const;
-	double FindBackgroundXForGivenY( const double y, const double x_guess ) const;
+	double FindBackgroundXForGivenY( const double y, const double x1, const double x2 ) const;
+
+	// Background between u1 and u2 in counts per bin, adding its derivatives to gradient
+	template <typename P>
+	double IntegrateBackground( P poly, const double u1, const double u2, const double width, double *gradient ) const {
+		double u1_power = u1;
+		double u2_power = u2;
+		for ( unsigned int k = 0; k <= poly.Order( m_background_polynomial_level ); ++k ){
+			gradient[k] += ( u2_power - u1_power )/( ( k + 1 )*width );
+			u1_power *= u1;
+			u2_power *= u2;
+		}
+		return poly.Integral( m_bg_value.data(), u1, u2, m_background_polynomial_level )/width;
+	}
 
 
 	template <typename T>
@@ -0,0 +1,111 @@
+// Class to read spectra from raw binary or text files, without a ROOT file
+#ifndef _SPECTRUM_LOADER_HH_
+#define _SPECTRUM_LOADER_HH_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <TMath.h>
+#include <TString.h>
+#include "BinView.hh"
+#include "MessageLogger.hh"
+
+// Binary files are a header of a fixed size followed by one number per bin, and
+// are memory-mapped. The view points straight into the mapping when the numbers
+// are in the byte order of this machine, aligned, and of a type SFBinView reads
+// (any but 64-bit integers); otherwise they are converted to doubles once. Text
+// files have one bin per line, either "x counts" (x being the bin centre) or
+// just the counts, separated by spaces, tabs or commas. Blank lines, lines
+// starting with # and a header line are skipped. Without x values the bins start
+// at the lower edge and have the width given to the loader.
+class SFSpectrumLoader{
+public:
+	// Type of each number in a binary file
+	enum DataType : unsigned char {
+		DataTypeInt8 = 0, DataTypeUInt8, DataTypeInt16, DataTypeUInt16, DataTypeInt32, DataTypeUInt32,
+		DataTypeInt64, DataTypeUInt64, DataTypeFloat, DataTypeDouble
+	};
+
+	// Constructor/destructor
+	SFSpectrumLoader();
+	~SFSpectrumLoader();
+
+	// The view keeps the mapping or the numbers read alive. Returns false if the
+	// file cannot be read or holds no bins.
+	bool ReadBinary( const TString &file_name, SFBinView &view ) const;
+	bool ReadASCII( const TString &file_name, SFBinView &view ) const;
+
+	// Names used in the config file ("int8", "uint8", ... "uint64", "float", "double")
+	static bool GetDataType( const TString &s, DataType &type );
+	static unsigned int GetDataSize( const DataType type );
+
+	// Setters
+	inline void SetDataType( const DataType t ){ m_data_type = t; }
+	inline void SetBigEndian( const bool b ){ m_big_endian = b; }
+	inline void SetHeaderSize( const unsigned long n ){ m_header_size = n; }
+	inline void SetNumberOfBins( const unsigned long n ){ m_number_of_bins = n; }
+	inline void SetLB( const double x ){ m_lb = x; }
+	inline void SetBinWidth( const double x ){ m_bin_width = x; }
+
+	// Getters
+	inline DataType GetDataType() const { return m_data_type; }
+	inline bool IsBigEndian() const { return m_big_endian; }
+	inline unsigned long GetHeaderSize() const { return m_header_size; }
+	inline unsigned long GetNumberOfBins() const { return m_number_of_bins; }
+	inline double GetLB() const { return m_lb; }
+	inline double GetBinWidth() const { return m_bin_width; }
+
+private:
+	DataType m_data_type;
+	bool m_big_endian;
+	unsigned long m_header_size;	// bytes skipped at the start of a binary file
+	unsigned long m_number_of_bins;	// 0 = the rest of the file
+	double m_lb;					// Lower edge of the first bin, without x values
+	double m_bin_width;				// Width of each bin, without x values
+
+	MessageLogger *log = MessageLogger::GetInstance();
+
+	// What a view of a file points into (shared by the view and its copies)
+	struct Buffer{
+		void *map = nullptr;
+		size_t map_size = 0;
+		std::vector<double> edges;
+		std::vector<double> contents;	// Only if the file is not viewed as it is
+		Buffer() = default;
+		Buffer( const Buffer& b ) = delete;
+		~Buffer(){ if ( map != nullptr )munmap( map, map_size ); }
+	};
+
+	// Private functions
+	bool IsSwapped() const;
+	bool GetContentType( SFBinView::ContentType &type ) const;
+
+	template <typename T>
+	void ConvertValues( const unsigned char *data, const unsigned long n, std::vector<double> &contents ) const {
+		const bool swap = IsSwapped();
+		unsigned char bytes[sizeof(T)];
+		T value;
+
+		contents.resize(n);
+		for ( unsigned long i = 0; i < n; ++i ){
+			std::memcpy( bytes, data + i*sizeof(T), sizeof(T) );
+			if ( swap )std::reverse( bytes, bytes + sizeof(T) );
+			std::memcpy( &value, bytes, sizeof(T) );
+			contents[i] = value;
+		}
+		return;
+	}
+};
+
+#endif
@@ -0,0 +1,31 @@
+// Runs independent tasks (e.g. fits) on a fixed number of worker threads
+#ifndef _THREAD_POOL_HH_
+#define _THREAD_POOL_HH_
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <TMath.h>
+#include "MessageLogger.hh"
+
+class SFThreadPool{
+public:
+	// Constructor/destructor
+	SFThreadPool( const unsigned int number_of_threads );
+	~SFThreadPool();
+
+	// Call task(i) for i = 0 ... number_of_tasks - 1 and wait for all of them to finish.
+	// Tasks are handed out in order, but may complete in any order.
+	void Execute( const unsigned int number_of_tasks, const std::function<void(unsigned int)> &task ) const;
+
+	// Getters
+	inline unsigned int GetNumberOfThreads() const { return m_number_of_threads; }
+
+private:
+	unsigned int m_number_of_threads;
+
+	MessageLogger *log = MessageLogger::GetInstance();
+};
+
+#endif
@@ -1,8 +1,11 @@
+#include "BatchFitter.hh"
 #include "CommandLineInterface.hh"
 #include "FitWriter.hh"
+#include "HistogramCache.hh"
 #include "InputFileProcessor.hh"
 #include "MessageLogger.hh"
 #include "Peak.hh"
+#include "Profiler.hh"
 #include "Spectrum.hh"
 #include "SpectrumDrawer.hh"
 #include "SpectrumFitter.hh"
@@ -28,8 +31,10 @@
 // GLOBAL VARIABLES (for command line interface)
 TString g_spectrum_fitter_file_location = "";
 TString g_fit_paramater_output_file_location  = "";
+TString g_profile_file_location = "";
 bool g_help_flag = false;
 bool g_print_debug_messages = false;
+int g_number_of_threads = 1;
 MessageLogger* MessageLogger::m_instance_ptr = nullptr;
 
 int main( int argc, char *argv[] ){
@@ -46,6 +51,8 @@ int main( int argc, char *argv[] ){
 	// Specify options
 	interface->Add("-s", "Spectrum fitter file", &g_spectrum_fitter_file_location );
 	interface->Add("-d", "Print debug messages when running", &g_print_debug_messages );
+	interface->Add("-j", "Number of fits to run in parallel (0 = all cores)", &g_number_of_threads );
+	interface->Add("--profile", "Write the time taken by each stage to this JSON file", &g_profile_file_location );
 	interface->Add("-h", "Print this help", &g_help_flag );
 	log->Debug("Added options to CommandLineInterface instance");
 
@@ -77,6 +84,19 @@ int main( int argc, char *argv[] ){
 		return 1;
 	}
 
+	// Check the number of threads makes sense
+	if ( g_number_of_threads < 0 ){
+		log->Error("The number of threads given with the \"-j\" flag cannot be negative.");
+		return 1;
+	}
+
+	// Time each stage if asked to
+	SFProfiler *profiler = SFProfiler::GetInstance();
+	profiler->SetEnabled( g_profile_file_location != "" );
+
+	// Files and histograms read by InputFileProcessor
+	SFHistogramCache *histogram_cache = SFHistogramCache::GetInstance();
+
 	// BEGIN PROCESSING THE SPECTRUM ----------------------------------------------------------- //
 	// Create a spectrum
 	SFSpectrum *spec = new SFSpectrum();
@@ -108,43 +128,116 @@ int main( int argc, char *argv[] ){
 	log->Debug("Input configuration file set");
 	
 	// Process input spectrum file
+	profiler->Start("ProcessOptions");
 	ifp->ProcessOptions();
+	profiler->Stop();
 	log->Debug("InputFileProcessor finished processing input options");
 
+	// Batch mode -- the config selects more than one histogram
+	if ( ifp->GetNumberOfHistograms() > 1 ){
+		SFBatchFitter *bf = new SFBatchFitter();
+		bf->SetInputFileProcessor(ifp);
+		bf->SetFitWriter(fw);
+		bf->SetNumberOfThreads( g_number_of_threads );
+		profiler->Start("Initialise");
+		bf->Initialise(spec);
+		profiler->Stop();
+		log->Debug( Form( "SFBatchFitter set up for %u histograms", bf->GetNumberOfSpectra() ) );
+
+		profiler->Start("FitSpectra");
+		bf->FitSpectra();
+		profiler->Stop();
+		log->Debug("SFBatchFitter spectra fit");
+		profiler->Start("DrawSpectra");
+		bf->DrawSpectra();
+		profiler->Stop();
+		log->Debug("SFBatchFitter spectra drawn");
+		profiler->Start("WriteFits");
+		bf->WriteFits();
+		profiler->Stop();
+		log->Debug("SFBatchFitter fits written to file");
+
+		if ( profiler->IsEnabled() ){
+			profiler->WriteJSON( g_profile_file_location );
+		}
+
+		// Memory management
+		log->Debug("Beginning memory management");
+		delete bf;
+		delete ifp;
+		delete fw;
+		delete sd;
+		delete sf;
+		delete spec;
+		delete interface;
+		delete histogram_cache;
+		delete profiler;
+		log->Debug("Memory management successful");
+
+		log->Debug("Main application complete");
+		delete log;
+		return 0;
+	}
+
 	// Fit the spectrum
 	sf->SetSpectrum(spec);
+	sf->SetNumberOfThreads( g_number_of_threads );
+	profiler->Start("InitialiseSpectrumGuesses");
 	sf->InitialiseSpectrumGuesses();
+	profiler->Stop();
 	log->Debug("SFSpectrumFitter initialised spectrum guesses");
+	profiler->Start("GenerateInitialFits");
 	sf->GenerateInitialFits();
+	profiler->Stop();
 	log->Debug("SFSpectrumFitter fits generated");
+	profiler->Start("SetFittingOptions");
 	sf->SetFittingOptions();
+	profiler->Stop();
 	log->Debug("SFSpectrumFitter fit options implemented");
+	profiler->Start("FitPeaks");
 	sf->FitPeaks();
+	profiler->Stop();
 	log->Debug("SFSpectrumFitter peaks fit");
+	profiler->Start("CalculateIntegrals");
 	sf->CalculateIntegrals();
+	profiler->Stop();
 	log->Debug("SFSpectrumFitter integrals calculated");
 
 	// Check whether to open the canvas interactively
 	TApplication *app = nullptr;
 	if ( sd->GetInteractiveMode() ){
+		SFProfiler::Timer timer("TApplication");
 		app = new TApplication( "spectrum_fitter", &argc, argv );
 		log->Debug("Interactive mode enabled");
 	}
 
 	// Draw the spectrum
 	sd->SetSpectrum(spec);
+	profiler->Start("FormatSpectrum");
 	sd->FormatSpectrum();
+	profiler->Stop();
 	log->Debug("SFSpectrumDrawer formatted spectrum");
+	profiler->Start("DrawSpectrum");
 	sd->DrawSpectrum();
+	profiler->Stop();
 	log->Debug("SFSpectrumDrawer drawn spectrum");
+	profiler->Start("PrintCanvas");
 	sd->PrintCanvas();
+	profiler->Stop();
 	log->Debug("SFSpectrumDrawer canvas saved");
 
 	// Write the fits to a nice convenient format
 	fw->SetSpectrum( spec );
+	profiler->Start("WriteFits");
 	fw->WriteFits();
+	profiler->Stop();
 	log->Debug("SFFitWriter Fits written to file");
 
+	// The interactive session is not timed
+	if ( profiler->IsEnabled() ){
+		profiler->WriteJSON( g_profile_file_location );
+	}
+
 	// Do the interactive canvas options
 	if ( sd->GetInteractiveMode() && app != nullptr ){
 		TCanvas *c = sd->GetCanvas();
@@ -163,6 +256,8 @@ int main( int argc, char *argv[] ){
 	delete sf;
 	delete spec;
 	delete interface;
+	delete histogram_cache;
+	delete profiler;
 	log->Debug("Memory management successful");
 
 	log->Debug("Main application complete");
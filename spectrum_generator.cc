@@ -0,0 +1,118 @@
+// Writes a synthetic spectrum to a ROOT file, with a config file for spectrum_fitter
+#include "CommandLineInterface.hh"
+#include "MessageLogger.hh"
+#include "SpectrumGenerator.hh"
+
+#include <TFile.h>
+#include <TH1D.h>
+#include <TString.h>
+
+// GLOBAL VARIABLES (for command line interface)
+TString g_root_file_location = "synthetic.root";
+TString g_config_file_location = "";
+TString g_hist_name = "synthetic";
+int g_number_of_peaks = 10;
+int g_number_of_bins = 1000;
+TString g_lb = "1000";
+TString g_ub = "2000";
+TString g_counts = "1e5";
+TString g_background_fraction = "0.2";
+TString g_width = "-1";
+TString g_width_model = "const";
+TString g_background_shape = "flat";
+int g_seed = 1;
+bool g_help_flag = false;
+bool g_print_debug_messages = false;
+MessageLogger* MessageLogger::m_instance_ptr = nullptr;
+
+int main( int argc, char *argv[] ){
+	MessageLogger* log = MessageLogger::GetInstance();
+	log->SetPrintConsoleLevel( MessageLogger::LevelWarning );
+
+	CommandLineInterface *interface = new CommandLineInterface();
+	interface->Add("-o", "ROOT file to write", &g_root_file_location );
+	interface->Add("-c", "Config file to write (default: the ROOT file name ending .dat)", &g_config_file_location );
+	interface->Add("-n", "Histogram name", &g_hist_name );
+	interface->Add("-p", "Number of peaks", &g_number_of_peaks );
+	interface->Add("-b", "Number of bins", &g_number_of_bins );
+	interface->Add("--lb", "Lower edge of the histogram", &g_lb );
+	interface->Add("--ub", "Upper edge of the histogram", &g_ub );
+	interface->Add("-N", "Expected number of counts", &g_counts );
+	interface->Add("--bg-fraction", "Fraction of the counts in the background", &g_background_fraction );
+	interface->Add("--bg", "Background shape (flat, linear or exp)", &g_background_shape );
+	interface->Add("--width", "Peak sigma in the middle of the range (default: from the peak spacing)", &g_width );
+	interface->Add("--width-model", "Peak width against x (const, sqrt or linear)", &g_width_model );
+	interface->Add("--seed", "Random number seed", &g_seed );
+	interface->Add("-d", "Print debug messages when running", &g_print_debug_messages );
+	interface->Add("-h", "Print this help", &g_help_flag );
+	interface->CheckFlags( argc, argv );
+
+	if ( g_print_debug_messages ){
+		log->SetPrintConsoleLevel( MessageLogger::LevelConstruction );
+	}
+
+	if ( g_help_flag ){
+		interface->CheckFlags( 1, argv );
+		delete interface;
+		delete log;
+		return 0;
+	}
+
+	// Check the options
+	SFSpectrumGenerator::WidthModel width_model;
+	SFSpectrumGenerator::BackgroundShape background_shape;
+	if ( !SFSpectrumGenerator::GetWidthModel( g_width_model, width_model ) ){
+		log->Error( Form( "Unknown width model \"%s\" (use const, sqrt or linear)", g_width_model.Data() ) );
+		return 1;
+	}
+	if ( !SFSpectrumGenerator::GetBackgroundShape( g_background_shape, background_shape ) ){
+		log->Error( Form( "Unknown background shape \"%s\" (use flat, linear or exp)", g_background_shape.Data() ) );
+		return 1;
+	}
+	if ( g_number_of_peaks < 0 || g_number_of_bins <= 0 || g_seed < 0 ){
+		log->Error("The number of peaks, number of bins and seed cannot be negative, and there must be at least one bin");
+		return 1;
+	}
+
+	if ( g_config_file_location == "" ){
+		g_config_file_location = g_root_file_location;
+		if ( g_config_file_location.EndsWith(".root") )g_config_file_location.Remove( g_config_file_location.Length() - 5 );
+		g_config_file_location.Append(".dat");
+	}
+
+	// Make the spectrum
+	SFSpectrumGenerator *sg = new SFSpectrumGenerator();
+	sg->SetNumberOfPeaks( g_number_of_peaks );
+	sg->SetNumberOfBins( g_number_of_bins );
+	sg->SetRange( g_lb.Atof(), g_ub.Atof() );
+	sg->SetCounts( g_counts.Atof() );
+	sg->SetBackgroundFraction( g_background_fraction.Atof() );
+	sg->SetWidth( g_width.Atof() );
+	sg->SetWidthModel( width_model );
+	sg->SetBackgroundShape( background_shape );
+	sg->SetSeed( g_seed );
+	sg->GeneratePeaks();
+
+	TH1D *h = sg->GenerateHistogram( g_hist_name );
+	log->Debug( Form( "Generated %s with %d bins and %.0f counts", g_hist_name.Data(), h->GetNbinsX(), h->GetEntries() ) );
+
+	TFile *f = new TFile( g_root_file_location, "RECREATE" );
+	if ( f == nullptr || f->IsZombie() ){
+		log->Error( Form( "Could not open %s", g_root_file_location.Data() ) );
+		return 1;
+	}
+	h->Write();
+	f->Close();
+	log->Debug( Form( "Wrote %s to %s", g_hist_name.Data(), g_root_file_location.Data() ) );
+
+	sg->WriteConfigFile( g_config_file_location, g_root_file_location, g_hist_name );
+	log->Debug( Form( "Wrote the config file %s", g_config_file_location.Data() ) );
+
+	// Memory management
+	delete f;
+	delete h;
+	delete sg;
+	delete interface;
+	delete log;
+	return 0;
+}
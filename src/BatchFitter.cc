@@ -0,0 +1,107 @@
+#include "BatchFitter.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFBatchFitter::SFBatchFitter(){
+	m_ifp = nullptr;
+	m_fw = nullptr;
+	m_spec_list.resize(0);
+	m_number_of_threads = 1;
+	log->Construction("SFBatchFitter::SFBatchFitter -- SFBatchFitter object constructed");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFBatchFitter::~SFBatchFitter(){
+	// The first spectrum belongs to the caller
+	for ( unsigned int i = 1; i < m_spec_list.size(); ++i ){
+		delete m_spec_list.at(i);
+	}
+	m_spec_list.clear();
+	log->Construction("SFBatchFitter::~SFBatchFitter -- SFBatchFitter object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFBatchFitter::Initialise( SFSpectrum *first_spectrum ){
+	if ( m_ifp == nullptr ){
+		log->Error("SFBatchFitter::Initialise -- InputFileProcessor not set");
+	}
+
+	m_spec_list.resize( m_ifp->GetNumberOfHistograms() );
+	m_spec_list.at(0) = first_spectrum;
+	for ( unsigned int i = 1; i < m_spec_list.size(); ++i ){
+		m_spec_list.at(i) = new SFSpectrum();
+		m_ifp->ProcessSpectrumOptions( i, m_spec_list.at(i) );
+	}
+
+	log->Debug( Form( "SFBatchFitter::Initialise -- Set up %lu spectra", m_spec_list.size() ) );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Each spectrum is fitted from start to finish on one thread. The fits within a
+// spectrum are run serially, so that the threads are not shared out twice.
+void SFBatchFitter::FitSpectra(){
+	SFThreadPool pool( m_number_of_threads );
+	if ( pool.GetNumberOfThreads() > 1 ){
+		ROOT::EnableThreadSafety();
+	}
+
+	SFProfiler *profiler = SFProfiler::GetInstance();
+	const int timer = profiler->GetCurrentTimer();
+	pool.Execute( m_spec_list.size(), [&]( unsigned int i ){
+		SFProfiler::Timer spectrum_timer( m_ifp->GetHistogramLabel(i), timer );
+		SFSpectrumFitter sf;
+		sf.SetSpectrum( m_spec_list.at(i) );
+		sf.SetFitCache( m_ifp->GetFitCache() );
+		profiler->Start("InitialiseSpectrumGuesses");
+		sf.InitialiseSpectrumGuesses();
+		profiler->Stop();
+		profiler->Start("GenerateInitialFits");
+		sf.GenerateInitialFits();
+		profiler->Stop();
+		profiler->Start("SetFittingOptions");
+		sf.SetFittingOptions();
+		profiler->Stop();
+		profiler->Start("FitPeaks");
+		sf.FitPeaks();
+		profiler->Stop();
+		profiler->Start("CalculateIntegrals");
+		sf.CalculateIntegrals();
+		profiler->Stop();
+		log->Debug( Form( "SFBatchFitter::FitSpectra -- Fitted %s", m_ifp->GetHistogramLabel(i).Data() ) );
+	} );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// ROOT graphics are not thread-safe, and a new canvas replaces any other with the
+// same name, so each spectrum is drawn and printed before the next is started
+void SFBatchFitter::DrawSpectra(){
+	for ( unsigned int i = 0; i < m_spec_list.size(); ++i ){
+		SFSpectrumDrawer *sd = new SFSpectrumDrawer();
+		m_ifp->ProcessDrawerOptions( i, sd );
+		if ( sd->GetInteractiveMode() && i == 0 ){
+			log->Warning("SFBatchFitter::DrawSpectra -- InteractiveMode is ignored when fitting more than one histogram");
+		}
+
+		SFProfiler::Timer timer( m_ifp->GetHistogramLabel(i) );
+		sd->SetSpectrum( m_spec_list.at(i) );
+		sd->FormatSpectrum();
+		sd->DrawSpectrum();
+		SFProfiler::GetInstance()->Start("PrintCanvas");
+		sd->PrintCanvas();
+		SFProfiler::GetInstance()->Stop();
+		delete sd;
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// All spectra go to the one FitParameterFile, each under its own header
+void SFBatchFitter::WriteFits(){
+	if ( m_fw == nullptr ){
+		log->Error("SFBatchFitter::WriteFits -- FitWriter object not initialised");
+	}
+
+	for ( unsigned int i = 0; i < m_spec_list.size(); ++i ){
+		m_fw->SetSpectrum( m_spec_list.at(i) );
+		m_fw->SetSpectrumLabel( m_ifp->GetHistogramLabel(i) );
+		m_fw->SetAppendMode( i > 0 );
+		m_fw->WriteFits();
+	}
+	return;
+}
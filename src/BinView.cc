@@ -0,0 +1,121 @@
+#include "BinView.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFBinView::SFBinView(){
+	m_number_of_bins = 0;
+	m_type = ContentDouble;
+	m_contents = nullptr;
+	m_edges = nullptr;
+	m_errors = nullptr;
+	m_errors_squared = false;
+	m_first = 1;
+}
+///////////////////////////////////////////////////////////////////////////////
+// TH1C, TH1S, TH1I, TH1F and TH1D keep their bins (with the underflow first) in
+// the array they inherit, and TH1::Sumw2 keeps the squared errors in the same order
+SFBinView::SFBinView( const TH1 *h ) : SFBinView() {
+	if ( h == nullptr )return;
+	if ( h->GetDimension() != 1 ){
+		log->Warning( Form( "SFBinView::SFBinView -- %s is not a 1D histogram. Only its first row of bins is used", h->GetName() ) );
+	}
+
+	const int n = h->GetNbinsX();
+	m_number_of_bins = n;
+	std::shared_ptr<OwnArrays> own = std::make_shared<OwnArrays>();
+	m_own = own;
+	const TArrayD *bins = h->GetXaxis()->GetXbins();
+	if ( bins != nullptr && bins->GetSize() == n + 1 ){
+		m_edges = bins->GetArray();
+	}
+	else{
+		own->edges.resize( n + 1 );
+		for ( int i = 1; i <= n + 1; ++i ){
+			own->edges[i-1] = h->GetXaxis()->GetBinLowEdge(i);
+		}
+		m_edges = own->edges.data();
+	}
+
+	m_first = 0;
+	const TArrayD *array_d = nullptr;
+	const TArrayF *array_f = nullptr;
+	const TArrayI *array_i = nullptr;
+	const TArrayS *array_s = nullptr;
+	const TArrayC *array_c = nullptr;
+	if ( h->InheritsFrom("TProfile") ){} // Bin contents are not the stored sums
+	else if ( ( array_d = dynamic_cast<const TArrayD*>(h) ) ){ m_contents = array_d->GetArray(); m_type = ContentDouble; }
+	else if ( ( array_f = dynamic_cast<const TArrayF*>(h) ) ){ m_contents = array_f->GetArray(); m_type = ContentFloat; }
+	else if ( ( array_i = dynamic_cast<const TArrayI*>(h) ) ){ m_contents = array_i->GetArray(); m_type = ContentInt; }
+	else if ( ( array_s = dynamic_cast<const TArrayS*>(h) ) ){ m_contents = array_s->GetArray(); m_type = ContentShort; }
+	else if ( ( array_c = dynamic_cast<const TArrayC*>(h) ) ){ m_contents = array_c->GetArray(); m_type = ContentChar; }
+
+	if ( m_contents == nullptr ){
+		log->Debug( Form( "SFBinView::SFBinView -- Copying the bins of %s, as it is not a TH1C/S/I/F/D", h->GetName() ) );
+		m_first = 1;
+		m_type = ContentDouble;
+		own->contents.resize(n);
+		own->errors.resize(n);
+		for ( int i = 1; i <= n; ++i ){
+			own->contents[i-1] = h->GetBinContent(i);
+			own->errors[i-1] = h->GetBinError(i);
+		}
+		m_contents = own->contents.data();
+		m_errors = own->errors.data();
+		return;
+	}
+
+	const TArrayD *sumw2 = h->GetSumw2();
+	if ( sumw2 != nullptr && sumw2->GetSize() == n + 2 ){
+		m_errors = sumw2->GetArray();
+		m_errors_squared = true;
+	}
+}
+///////////////////////////////////////////////////////////////////////////////
+SFBinView::SFBinView( const std::shared_ptr<const TH1> &h ) : SFBinView( h.get() ) {
+	m_source = h;
+}
+///////////////////////////////////////////////////////////////////////////////
+SFBinView::SFBinView( const int n, const double *edges, const void *contents, const ContentType type, const double *errors ) : SFBinView() {
+	m_number_of_bins = n;
+	m_edges = edges;
+	m_contents = contents;
+	m_type = type;
+	m_errors = errors;
+}
+///////////////////////////////////////////////////////////////////////////////
+SFBinView::~SFBinView(){}
+///////////////////////////////////////////////////////////////////////////////
+void SFBinView::GetContents( const int first, const int last, double *y ) const {
+	if ( last < first )return;
+	const int offset = first - m_first;
+	const int n = last - first + 1;
+	switch ( m_type ){
+		case ContentChar: ConvertContents( (const char*)m_contents + offset, n, y ); break;
+		case ContentShort: ConvertContents( (const short*)m_contents + offset, n, y ); break;
+		case ContentInt: ConvertContents( (const int*)m_contents + offset, n, y ); break;
+		case ContentFloat: ConvertContents( (const float*)m_contents + offset, n, y ); break;
+		case ContentDouble: ConvertContents( (const double*)m_contents + offset, n, y ); break;
+		case ContentUChar: ConvertContents( (const unsigned char*)m_contents + offset, n, y ); break;
+		case ContentUShort: ConvertContents( (const unsigned short*)m_contents + offset, n, y ); break;
+		case ContentUInt: ConvertContents( (const unsigned int*)m_contents + offset, n, y ); break;
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+TH1D* SFBinView::MakeHistogram( const TString &name, const TString &title ) const {
+	if ( m_number_of_bins <= 0 )return nullptr;
+	TH1D *h = new TH1D( name, title, m_number_of_bins, m_edges );
+	h->SetDirectory(nullptr);
+	double entries = 0.0;
+	for ( int i = 1; i <= m_number_of_bins; ++i ){
+		h->SetBinContent( i, GetContent(i) );
+		if ( m_errors != nullptr )h->SetBinError( i, GetError(i) );
+		entries += GetContent(i);
+	}
+	h->SetEntries( entries );
+	return h;
+}
+///////////////////////////////////////////////////////////////////////////////
+unsigned int SFBinView::GetContentSize( const ContentType type ){
+	const unsigned int sizes[] = { sizeof(char), sizeof(short), sizeof(int), sizeof(float), sizeof(double), sizeof(unsigned char), sizeof(unsigned short), sizeof(unsigned int) };
+	return sizes[type];
+}
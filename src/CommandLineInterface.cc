@@ -48,6 +48,11 @@ void CommandLineInterface::Add( const TString flag, const TString message, TStri
 	return;
 }
 ///////////////////////////////////////////////////////////////////////////////
+void CommandLineInterface::Add( const TString flag, const TString message, int* value ){
+	GeneralAdd( flag, message, "int", (void*)value );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
 void CommandLineInterface::CheckFlags( unsigned int argc, char* argv[] ){
 	// Declare loop variables
 	unsigned int i;
@@ -98,6 +103,12 @@ void CommandLineInterface::CheckFlags( unsigned int argc, char* argv[] ){
 					i++;
 					break;
 				}
+				// Int
+				else if ( m_types.at(j) == "int" ){
+					*( (int*)m_values.at(j) ) = TString( argv[i+1] ).Atoi();
+					i++;
+					break;
+				}
 
 			}
 
@@ -8,13 +8,13 @@ SFFit::SFFit(){
 	m_fit_limit_lb = -1;
 	m_fit_limit_ub = -1;
 
-	m_list_of_fit_parameter_types.resize(0);
-	m_parameter_number_to_peak_number_map.resize(0);
+	m_parameter_layout.resize(0);
 	m_list_of_peak_numbers.resize(0);
 
 	m_fit = nullptr;
 	m_fit_individual.resize(0);
 	m_fit_result = nullptr;
+	m_telemetry = { 0, 0, 0, 0.0, false };
 	
 	m_background_polynomial_level = -1;
 	m_bg_value.resize(0);
@@ -35,8 +35,7 @@ SFFit::~SFFit(){
 	}
 	delete m_fit;
 
-	m_list_of_fit_parameter_types.clear();
-	m_parameter_number_to_peak_number_map.clear();
+	m_parameter_layout.clear();
 	m_list_of_peak_numbers.clear();
 	m_fit_individual.clear();
 	m_bg_value.clear();
@@ -87,13 +86,6 @@ TF1* SFFit::GetIndividualFit( const unsigned int n ) const{
 	return nullptr;
 }
 ///////////////////////////////////////////////////////////////////////////////
-SFFit::FitParameterType SFFit::GetFitParameterType( const unsigned int n ) const{
-	if ( this->IsGoodParameterNumber(n) ){
-		return m_list_of_fit_parameter_types.at(n);
-	}
-	return FitParameterType::FitParameterNULL;
-}
-///////////////////////////////////////////////////////////////////////////////
 double SFFit::GetBGCovMatrix( unsigned int i, unsigned int j ) const{
 	if ( j > i ){
 		log->Warning("SFFit::GetBGCovMatrix -- First element should be larger than second in covariance matrix function...swapping them over!");
@@ -116,9 +108,9 @@ void SFFit::SetIndividualFit(const unsigned int n, TF1* fit){
 	return;
 }
 ///////////////////////////////////////////////////////////////////////////////
-void SFFit::SetFitParameterType(const unsigned int n, const FitParameterType type){
+void SFFit::SetFitParameter( const unsigned int n, const FitParameter &par ){
 	if ( this->IsGoodParameterNumber(n) ){
-		m_list_of_fit_parameter_types.at(n) = type;
+		m_parameter_layout[n] = par;
 	}
 	return;
 }
@@ -160,12 +152,8 @@ void SFFit::SetNumberOfFitParameters( const int n ){
 	}
 
 	m_number_of_parameters = n;
-	m_list_of_fit_parameter_types.resize(n);
-	m_parameter_number_to_peak_number_map.resize(n);
-	for ( unsigned int i = 0; i < m_list_of_fit_parameter_types.size(); ++i ){
-		m_list_of_fit_parameter_types.at(i) = FitParameterType::FitParameterNULL;
-		m_parameter_number_to_peak_number_map.at(i) = -1;
-	}
+	FitParameter empty = { FitParameterType::FitParameterNULL, -1, 0.0, 0.0, 0.0, false };
+	m_parameter_layout.assign( n, empty );
 
 	return;
 }
@@ -241,46 +229,34 @@ TString SFFit::GenerateTotalFitString( const bool is_individual_fit ){
 		return fit_string;
 	}
 
-	// Generate fits with multiple peaks (and store parameter values!)
-	int par_num = 1;
-	this->SetFitParameterType( 0, FitParameterType::FitParameterWidth );
+	// Generate fits with multiple peaks from the parameter layout
+	unsigned int par_num = 1;
+	while ( par_num < this->GetNumberOfFitParameters() ){
+		FitParameterType type = this->GetFitParameterType( par_num );
 
-	// Loop over peaks in the spectrum
-	for ( unsigned int i = 0; i < this->GetNumberOfPeaks(); ++i ){
-		SFPeak *peak = m_parent_spectrum->GetPeak( this->GetPeakNumber(i) );
-		
-		
-		if ( peak->HasFixedWidth() == true ){
+		// Fixed width
+		if ( type == FitParameterType::FitParameterWidth ){
 			fit_string.Append( GenerateGaussianString( par_num, 2 ) );
-			this->SetFitParameterType( par_num+0, FitParameterType::FitParameterWidth );
-			this->SetFitParameterType( par_num+1, FitParameterType::FitParameterAmplitude );
-			this->SetFitParameterType( par_num+2, FitParameterType::FitParameterMean );
 			par_num += 3;
 		}
 		// Doublet or unbound
-		else if ( peak->IsDoublet() || peak->IsUnbound()){
+		else if ( type == FitParameterType::FitParameterWidthScale ){
 			fit_string.Append( GenerateGaussianString( par_num, 1 ) );
-			this->SetFitParameterType( par_num+0, FitParameterType::FitParameterWidthScale );
-			this->SetFitParameterType( par_num+1, FitParameterType::FitParameterAmplitude );
-			this->SetFitParameterType( par_num+2, FitParameterType::FitParameterMean );
 			par_num += 3;
 		}
-		
-		else{
-			// Bound non-doublet
+		// Bound non-doublet
+		else if ( type == FitParameterType::FitParameterAmplitude ){
 			fit_string.Append( GenerateGaussianString( par_num, 0 ) );
-			this->SetFitParameterType( par_num+0, FitParameterType::FitParameterAmplitude );
-			this->SetFitParameterType( par_num+1, FitParameterType::FitParameterMean );
 			par_num += 2;
 		}
+		else{
+			break;
+		}
 		fit_string.Append(" + ");
 	}
 
 	// Add background to fit string
 	fit_string.Append( GenerateBackgroundString( par_num ) );
-	for ( unsigned int i = 0; i <= this->GetBGPolyOrder(); ++i ){
-		this->SetFitParameterType( par_num+i, FitParameterType::FitParameterBackground );
-	}
 
 	if ( log->GetPrintConsoleLevel() >= MessageLogger::Level::LevelDebug ){
 		for ( unsigned int i = 0; i < this->GetNumberOfFitParameters(); ++i ){
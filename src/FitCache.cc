@@ -0,0 +1,98 @@
+#include "FitCache.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFFitCache::SFFitCache( const TString &directory ){
+	m_directory = directory;
+	if ( gSystem->AccessPathName( m_directory.Data() ) && gSystem->mkdir( m_directory.Data(), true ) != 0 ){
+		log->Warning( Form( "SFFitCache::SFFitCache -- Could not create the fit cache directory %s", m_directory.Data() ) );
+	}
+	log->Construction("SFFitCache::SFFitCache -- SFFitCache object constructed");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFFitCache::~SFFitCache(){
+	log->Construction("SFFitCache::~SFFitCache -- SFFitCache object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+// 64-bit FNV-1a hash, written as 16 hex digits
+TString SFFitCache::GetKey( const TF1 *fit_func, const std::vector<double> &x, const std::vector<double> &y, const TString &fit_options ) const {
+	uint64_t hash = 14695981039346656037ULL;
+	AddToHash( hash, &m_format_version, sizeof( m_format_version ) );
+	AddToHash( hash, fit_options.Data(), fit_options.Length() + 1 );
+
+	// Parameters as set by SFSpectrumFitter::SetFittingOptions
+	int npar = fit_func->GetNpar();
+	AddToHash( hash, &npar, sizeof( npar ) );
+	for ( int i = 0; i < npar; ++i ){
+		double lb, ub;
+		fit_func->GetParLimits( i, lb, ub );
+		const char *name = fit_func->GetParName(i);
+		AddToHash( hash, name, strlen( name ) + 1 );
+		AddToHash( hash, fit_func->GetParameter(i) );
+		AddToHash( hash, lb );
+		AddToHash( hash, ub );
+	}
+
+	// Bin slice of the fit window
+	size_t nbins = x.size();
+	AddToHash( hash, &nbins, sizeof( nbins ) );
+	for ( size_t i = 0; i < nbins; ++i ){
+		AddToHash( hash, x[i] );
+		AddToHash( hash, y[i] );
+	}
+
+	return TString::Format( "%016llx", (unsigned long long)hash );
+}
+///////////////////////////////////////////////////////////////////////////////
+SFFitResult* SFFitCache::Load( const TString &key, const TF1 *fit_func ) const {
+	std::ifstream input( GetFileName( key ).Data() );
+	if ( !input.is_open() )return nullptr;
+
+	SFFitResult *result = new SFFitResult( fit_func );
+	if ( !result->ReadText( input ) || result->NPar() != (unsigned int)fit_func->GetNpar() ){
+		log->Warning( Form( "SFFitCache::Load -- Ignoring unreadable cached fit %s", GetFileName( key ).Data() ) );
+		delete result;
+		return nullptr;
+	}
+	return result;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Written to a temporary file first, so that a fit running on another thread (or
+// another process using the same cache) never reads half a result
+void SFFitCache::Save( const TString &key, const SFFitResult *result ) const {
+	TString file_name = GetFileName( key );
+	TString temp_name = Form( "%s.%zx.tmp", file_name.Data(), std::hash<std::thread::id>()( std::this_thread::get_id() ) );
+
+	std::ofstream output( temp_name.Data() );
+	if ( !output.is_open() ){
+		log->Warning( Form( "SFFitCache::Save -- Could not write to the fit cache (%s)", temp_name.Data() ) );
+		return;
+	}
+	result->WriteText( output );
+	output.close();
+
+	if ( std::rename( temp_name.Data(), file_name.Data() ) != 0 ){
+		log->Warning( Form( "SFFitCache::Save -- Could not write to the fit cache (%s)", file_name.Data() ) );
+		std::remove( temp_name.Data() );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+TString SFFitCache::GetFileName( const TString &key ) const {
+	return m_directory + "/" + key + ".fit";
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFFitCache::AddToHash( uint64_t &hash, const void *data, const size_t size ) const {
+	const unsigned char *bytes = static_cast<const unsigned char*>( data );
+	for ( size_t i = 0; i < size; ++i ){
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// -0.0 and 0.0 hash the same
+void SFFitCache::AddToHash( uint64_t &hash, const double x ) const {
+	double y = ( x == 0.0 ? 0.0 : x );
+	AddToHash( hash, &y, sizeof( y ) );
+	return;
+}
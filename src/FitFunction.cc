@@ -0,0 +1,172 @@
+#include "FitFunction.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFFitFunction::SFFitFunction(){
+	m_width_mode.resize(0);
+	m_width_index.resize(0);
+	m_amplitude_index.resize(0);
+	m_mean_index.resize(0);
+
+	m_bg_index = 0;
+	m_background_polynomial_level = 0;
+	m_number_of_parameters = 0;
+	m_parameters.resize(0);
+}
+///////////////////////////////////////////////////////////////////////////////
+// Build the parameter layout of the model from the layout table of the fit
+// (see SFSpectrum::CalculateNumberOfPeaksAndFitParameters). The individual fits
+// always have the layout [0] width, [1] amplitude, [2] mean, [3...] background.
+SFFitFunction::SFFitFunction( SFFit *fit, const bool is_individual_fit ) : SFFitFunction(){
+	m_background_polynomial_level = fit->GetBGPolyOrder();
+
+	// Individual fits
+	if ( is_individual_fit ){
+		m_width_mode.push_back( WidthModeCommon );
+		m_width_index.push_back(0);
+		m_amplitude_index.push_back(1);
+		m_mean_index.push_back(2);
+		m_bg_index = 3;
+		m_number_of_parameters = m_bg_index + m_background_polynomial_level + 1;
+		m_parameters.resize( m_number_of_parameters, 0.0 );
+		return;
+	}
+
+	// Fits with multiple peaks -- parameter 0 is always the common width
+	m_number_of_parameters = fit->GetNumberOfFitParameters();
+	m_parameters.resize( m_number_of_parameters, 0.0 );
+	unsigned int par_num = 1;
+
+	const std::vector<SFFit::FitParameter> &layout = fit->GetParameterLayout();
+	while ( par_num < m_number_of_parameters ){
+		SFFit::FitParameterType type = layout[par_num].type;
+
+		// Fixed width
+		if ( type == SFFit::FitParameterWidth ){
+			m_width_mode.push_back( WidthModeFixed );
+			m_width_index.push_back( par_num );
+			m_amplitude_index.push_back( par_num + 1 );
+			m_mean_index.push_back( par_num + 2 );
+			par_num += 3;
+		}
+		// Scaled common width (doublet or unbound)
+		else if ( type == SFFit::FitParameterWidthScale ){
+			m_width_mode.push_back( WidthModeScaled );
+			m_width_index.push_back( par_num );
+			m_amplitude_index.push_back( par_num + 1 );
+			m_mean_index.push_back( par_num + 2 );
+			par_num += 3;
+		}
+		// Common width (bound non-doublet)
+		else if ( type == SFFit::FitParameterAmplitude ){
+			m_width_mode.push_back( WidthModeCommon );
+			m_width_index.push_back(0);
+			m_amplitude_index.push_back( par_num );
+			m_mean_index.push_back( par_num + 1 );
+			par_num += 2;
+		}
+		// Background terms finish the list
+		else if ( type == SFFit::FitParameterBackground ){
+			break;
+		}
+		else{
+			log->Warning( Form( "SFFitFunction::SFFitFunction -- Unexpected parameter type for parameter %02d. Has SFSpectrum::CalculateNumberOfPeaksAndFitParameters been called?", par_num ) );
+			break;
+		}
+	}
+	m_bg_index = par_num;
+
+	if ( m_bg_index + m_background_polynomial_level + 1 != m_number_of_parameters ){
+		log->Warning( Form( "SFFitFunction::SFFitFunction -- Parameter layout does not add up (%d background parameters starting at %d, but %d parameters in total)", m_background_polynomial_level + 1, m_bg_index, m_number_of_parameters ) );
+	}
+}
+///////////////////////////////////////////////////////////////////////////////
+SFFitFunction::~SFFitFunction(){
+	m_width_mode.clear();
+	m_width_index.clear();
+	m_amplitude_index.clear();
+	m_mean_index.clear();
+	m_parameters.clear();
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFFitFunction::Evaluate( const double x, const double *p ) const {
+	double sum = 0.0;
+
+	// Gaussian peaks
+	for ( unsigned int i = 0; i < m_width_mode.size(); ++i ){
+		double sigma = this->GetSigma( i, p );
+		double t = ( x - p[ m_mean_index[i] ] )/sigma;
+		sum += p[ m_amplitude_index[i] ]*TMath::Exp( -0.5*t*t );
+	}
+
+	// Background polynomial
+	double bg = 0.0;
+	SFPolynomialDispatch( m_background_polynomial_level, [&]( auto poly ){
+		bg = poly.Value( p + m_bg_index, x, m_background_polynomial_level );
+	} );
+
+	return sum + bg;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Analytic derivatives of the model with respect to every parameter. For a peak
+// A*exp(-0.5*t^2) with t = (x-mean)/sigma:
+// df/dA = exp(-0.5*t^2), df/dmean = A*exp(-0.5*t^2)*t/sigma, df/dsigma = A*exp(-0.5*t^2)*t^2/sigma
+// and df/dsigma is then passed on to the common width, width scale or fixed width.
+void SFFitFunction::ParameterGradient( double x, const double *p, double *grad ) const {
+	for ( unsigned int i = 0; i < m_number_of_parameters; ++i ){
+		grad[i] = 0.0;
+	}
+
+	// Gaussian peaks
+	for ( unsigned int i = 0; i < m_width_mode.size(); ++i ){
+		double sigma = this->GetSigma( i, p );
+		double t = ( x - p[ m_mean_index[i] ] )/sigma;
+		double g = TMath::Exp( -0.5*t*t );
+		double dfdsigma = p[ m_amplitude_index[i] ]*g*t*t/sigma;
+
+		grad[ m_amplitude_index[i] ] += g;
+		grad[ m_mean_index[i] ] += p[ m_amplitude_index[i] ]*g*t/sigma;
+
+		if ( m_width_mode[i] == WidthModeScaled ){
+			grad[ m_width_index[i] ] += dfdsigma*p[0];
+			grad[0] += dfdsigma*p[ m_width_index[i] ];
+		}
+		else{
+			grad[ m_width_index[i] ] += dfdsigma;
+		}
+	}
+
+	// Background polynomial
+	SFPolynomialDispatch( m_background_polynomial_level, [&]( auto poly ){
+		double xn = 1.0;
+		for ( unsigned int i = 0; i <= poly.Order( m_background_polynomial_level ); ++i ){
+			grad[ m_bg_index + i ] = xn;
+			xn *= x;
+		}
+	} );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFFitFunction::DoParameterDerivative( double x, const double *p, unsigned int ipar ) const {
+	std::vector<double> grad( m_number_of_parameters );
+	this->ParameterGradient( x, p, grad.data() );
+	return grad.at(ipar);
+}
+///////////////////////////////////////////////////////////////////////////////
+// Derivative of the model with respect to x at the stored parameters
+double SFFitFunction::DoDerivative( double x ) const {
+	const double *p = this->Parameters();
+	double sum = 0.0;
+
+	for ( unsigned int i = 0; i < m_width_mode.size(); ++i ){
+		double sigma = this->GetSigma( i, p );
+		double t = ( x - p[ m_mean_index[i] ] )/sigma;
+		sum -= p[ m_amplitude_index[i] ]*TMath::Exp( -0.5*t*t )*t/sigma;
+	}
+
+	double bg = 0.0;
+	SFPolynomialDispatch( m_background_polynomial_level, [&]( auto poly ){
+		bg = poly.Derivative( p + m_bg_index, x, m_background_polynomial_level );
+	} );
+
+	return sum + bg;
+}
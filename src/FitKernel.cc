@@ -0,0 +1,197 @@
+#include "FitKernel.hh"
+
+#include <cstdint>
+#include <cstring>
+
+///////////////////////////////////////////////////////////////////////////////
+// exp(z) for z <= 0 using only arithmetic, so that the loops below vectorise.
+// The argument is split as z = k*ln2 + r with |r| <= ln2/2, exp(r) comes from a
+// degree-12 Taylor series (relative error ~1e-16) and 2^k is built directly in
+// the exponent bits. Arguments below -708 underflow to zero. The selects only
+// become vector blends with -fno-trapping-math (see KERNELFLAGS).
+static inline double FastNegativeExp( const double z ){
+	const double log2e = 1.4426950408889634;
+	const double ln2_hi = 6.93147180369123816490e-01;
+	const double ln2_lo = 1.90821492927058770002e-10;
+	const double shift = 6755399441055744.0;	// 1.5*2^52 -> rounds to an integer in the low mantissa bits
+
+	double zc = ( z < -708.0 ? -708.0 : z );
+	double kd = zc*log2e + shift;
+	double k = kd - shift;
+	double r = ( zc - k*ln2_hi ) - k*ln2_lo;
+
+	double poly = 1.0/479001600.0;
+	poly = poly*r + 1.0/39916800.0;
+	poly = poly*r + 1.0/3628800.0;
+	poly = poly*r + 1.0/362880.0;
+	poly = poly*r + 1.0/40320.0;
+	poly = poly*r + 1.0/5040.0;
+	poly = poly*r + 1.0/720.0;
+	poly = poly*r + 1.0/120.0;
+	poly = poly*r + 1.0/24.0;
+	poly = poly*r + 1.0/6.0;
+	poly = poly*r + 0.5;
+	poly = poly*r + 1.0;
+	poly = poly*r + 1.0;
+
+	// 2^k from the integer stored in the low bits of kd
+	uint64_t bits;
+	std::memcpy( &bits, &kd, sizeof(bits) );
+	bits = ( bits + 1023 ) << 52;
+	double scale;
+	std::memcpy( &scale, &bits, sizeof(scale) );
+
+	return ( z < -708.0 ? 0.0 : poly*scale );
+}
+///////////////////////////////////////////////////////////////////////////////
+// mu[i] += amp*exp( -0.5*( ( x[i] - mean )/sigma )^2 )
+SF_KERNEL_CLONES
+static void AddGaussian( const double *x, double *mu, const unsigned int n, const double amp, const double mean, const double inv_sigma ){
+	for ( unsigned int i = 0; i < n; ++i ){
+		double t = ( x[i] - mean )*inv_sigma;
+		mu[i] += amp*FastNegativeExp( -0.5*t*t );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// mu[i] = sum_j bg[j]*x[i]^j, with P the SFPolynomial for the order
+template <class P>
+SF_KERNEL_CLONES
+static void SetPolynomial( const double *x, double *mu, const unsigned int n, const double *bg, const unsigned int order ){
+	for ( unsigned int i = 0; i < n; ++i ){
+		mu[i] = P::Value( bg, x[i], order );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Weighted moments of a unit Gaussian: s0 = sum w*g, s1 = sum w*g*t, s2 = sum w*g*t^2
+SF_KERNEL_CLONES
+static void GaussianMoments( const double *x, const double *w, const unsigned int n, const double mean, const double inv_sigma, double &s0, double &s1, double &s2 ){
+	double sum0 = 0.0;
+	double sum1 = 0.0;
+	double sum2 = 0.0;
+	for ( unsigned int i = 0; i < n; ++i ){
+		double t = ( x[i] - mean )*inv_sigma;
+		double wg = w[i]*FastNegativeExp( -0.5*t*t );
+		sum0 += wg;
+		sum1 += wg*t;
+		sum2 += wg*t*t;
+	}
+	s0 = sum0;
+	s1 = sum1;
+	s2 = sum2;
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Weighted moments of the polynomial terms: m[j] = sum w*x^j
+template <class P>
+SF_KERNEL_CLONES
+static void PolynomialMoments( const double *x, const double *w, const unsigned int n, double *m, const unsigned int order ){
+	for ( unsigned int j = 0; j <= P::Order(order); ++j ){
+		double sum = 0.0;
+		for ( unsigned int i = 0; i < n; ++i ){
+			double xn = w[i];
+			for ( unsigned int k = 0; k < j; ++k ){
+				xn *= x[i];
+			}
+			sum += xn;
+		}
+		m[j] = sum;
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+SFFitKernel::SFFitKernel( const SFFitFunction &model, const std::vector<double> &x ) : m_model( model ), m_x( x ){
+	m_peak_range = 0.0;
+	log->Construction( Form( "SFFitKernel::SFFitKernel -- SFFitKernel object constructed for %lu bins (%s)", m_x.size(), GetInstructionSet().Data() ) );
+}
+///////////////////////////////////////////////////////////////////////////////
+SFFitKernel::~SFFitKernel(){
+	m_x.clear();
+	log->Construction("SFFitKernel::~SFFitKernel -- SFFitKernel object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFFitKernel::Evaluate( const double *p, double *mu ) const {
+	const unsigned int n = m_x.size();
+
+	// Background first, then add the peaks one at a time over all bins
+	const unsigned int order = m_model.GetBGPolyOrder();
+	SFPolynomialDispatch( order, [&]( auto poly ){
+		SetPolynomial<decltype(poly)>( m_x.data(), mu, n, p + m_model.GetBGParameterIndex(), order );
+	} );
+
+	for ( unsigned int k = 0; k < m_model.GetNumberOfPeaks(); ++k ){
+		double mean = p[ m_model.GetMeanIndex(k) ];
+		double sigma = m_model.GetSigma( k, p );
+		unsigned int first, m;
+		GetPeakBins( mean, sigma, first, m );
+		AddGaussian( m_x.data() + first, mu + first, m, p[ m_model.GetAmplitudeIndex(k) ], mean, 1.0/sigma );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// For a peak f = A*exp(-0.5*t^2), t = (x-mean)/sigma the weighted sums over the
+// bins give df/dA = s0, df/dmean = A*s1/sigma and df/dsigma = A*s2/sigma. The
+// width derivative is passed on in the same way as SFFitFunction::ParameterGradient.
+void SFFitKernel::WeightedGradient( const double *p, const double *w, double *grad ) const {
+	const unsigned int n = m_x.size();
+
+	for ( unsigned int j = 0; j < m_model.GetNumberOfParameters(); ++j ){
+		grad[j] = 0.0;
+	}
+
+	// Gaussian peaks
+	for ( unsigned int k = 0; k < m_model.GetNumberOfPeaks(); ++k ){
+		double sigma = m_model.GetSigma( k, p );
+		double amp = p[ m_model.GetAmplitudeIndex(k) ];
+		double mean = p[ m_model.GetMeanIndex(k) ];
+		double s0, s1, s2;
+		unsigned int first, m;
+		GetPeakBins( mean, sigma, first, m );
+		GaussianMoments( m_x.data() + first, w + first, m, mean, 1.0/sigma, s0, s1, s2 );
+
+		double dsigma = amp*s2/sigma;
+		grad[ m_model.GetAmplitudeIndex(k) ] += s0;
+		grad[ m_model.GetMeanIndex(k) ] += amp*s1/sigma;
+
+		if ( m_model.GetWidthMode(k) == SFFitFunction::WidthModeScaled ){
+			grad[ m_model.GetWidthIndex(k) ] += dsigma*p[0];
+			grad[0] += dsigma*p[ m_model.GetWidthIndex(k) ];
+		}
+		else{
+			grad[ m_model.GetWidthIndex(k) ] += dsigma;
+		}
+	}
+
+	// Background polynomial
+	const unsigned int order = m_model.GetBGPolyOrder();
+	SFPolynomialDispatch( order, [&]( auto poly ){
+		PolynomialMoments<decltype(poly)>( m_x.data(), w, n, grad + m_model.GetBGParameterIndex(), order );
+	} );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// The bins a peak is evaluated in, found by bisection of the bin centres
+void SFFitKernel::GetPeakBins( const double mean, const double sigma, unsigned int &first, unsigned int &n ) const {
+	double half_width = m_peak_range*TMath::Abs( sigma );
+	if ( m_peak_range <= 0.0 || m_x.size() < 2 || !( half_width < m_x.back() - m_x.front() ) ){
+		first = 0;
+		n = m_x.size();
+		return;
+	}
+
+	std::vector<double>::const_iterator lower = std::lower_bound( m_x.begin(), m_x.end(), mean - half_width );
+	std::vector<double>::const_iterator upper = std::upper_bound( lower, m_x.end(), mean + half_width );
+	first = lower - m_x.begin();
+	n = upper - lower;
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Report the version of the inner loops that is used on this machine
+TString SFFitKernel::GetInstructionSet(){
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+	if ( __builtin_cpu_supports("avx512f") )return "AVX-512";
+	if ( __builtin_cpu_supports("avx2") )return "AVX2";
+#endif
+	return "scalar";
+}
@@ -0,0 +1,215 @@
+#include "FitReader.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFFitReader::SFFitReader(){
+	m_list_of_results.resize(0);
+	log->Construction("SFFitReader::SFFitReader -- SFFitReader object constructed");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFFitReader::~SFFitReader(){
+	m_list_of_results.clear();
+	log->Construction("SFFitReader::~SFFitReader -- SFFitReader object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+// The file layout is the one written by SFFitWriter::WriteFits. Only the peak
+// ("P.nn") and fit ("Fit n") lines are needed -- integrals are recalculated anyway.
+void SFFitReader::ReadFile( const TString &file_location ){
+	std::ifstream input( file_location.Data() );
+	if ( !input.is_open() ){
+		log->Error( Form( "SFFitReader::ReadFile -- Could not open fit parameter file %s", file_location.Data() ) );
+	}
+
+	m_list_of_results.clear();
+	std::string line;
+	while ( std::getline( input, line ) ){
+		TString s = TString( line.c_str() ).Strip( TString::kBoth );
+		if ( s == "" )continue;
+
+		// Batch mode files have a label before each spectrum
+		if ( s.BeginsWith("# Spectrum:") ){
+			m_list_of_results.push_back( SpectrumResult() );
+			m_list_of_results.back().label = TString( s( 11, s.Length() - 11 ) ).Strip( TString::kBoth );
+			continue;
+		}
+
+		// Otherwise the column header starts the (only) spectrum
+		if ( s.BeginsWith("Peak num") ){
+			if ( m_list_of_results.size() == 0 || m_list_of_results.back().peaks.size() + m_list_of_results.back().fits.size() > 0 ){
+				m_list_of_results.push_back( SpectrumResult() );
+				m_list_of_results.back().label = "";
+			}
+			continue;
+		}
+
+		if ( m_list_of_results.size() == 0 ){
+			log->Warning( Form( "SFFitReader::ReadFile -- Ignoring line before the header in %s: %s", file_location.Data(), s.Data() ) );
+			continue;
+		}
+
+		SpectrumResult &result = m_list_of_results.back();
+		std::vector<TString> fields = SplitLine(s);
+
+		// Peak -- amplitude, error, sigma, error, mean, error, area, error, info
+		if ( s.BeginsWith("P.") ){
+			if ( fields.size() < 7 ){
+				log->Warning( Form( "SFFitReader::ReadFile -- Peak line is too short: %s", s.Data() ) );
+				continue;
+			}
+			PeakResult peak;
+			peak.amplitude = fields.at(1).Atof();
+			peak.amplitude_err = fields.at(2).Atof();
+			peak.width = fields.at(3).Atof();
+			peak.width_err = fields.at(4).Atof();
+			peak.mean = fields.at(5).Atof();
+			peak.mean_err = fields.at(6).Atof();
+			result.peaks.push_back( peak );
+		}
+		// Fit -- peak list, then value, error and info for each background term
+		else if ( s.BeginsWith("Fit ") ){
+			BackgroundResult fit;
+			fit.is_valid = true;
+
+			unsigned int i = 0;
+			while ( i < fields.size() && fields.at(i) != "Background:" )++i;
+			for ( i = i + 1; i + 1 < fields.size() && fields.at(i) != "Red. chi-sq."; i += 3 ){
+				fit.bg.push_back( fields.at(i).Atof() );
+				fit.bg_err.push_back( fields.at(i+1).Atof() );
+			}
+			result.fits.push_back( fit );
+		}
+		// Written straight after a fit that failed
+		else if ( s.Contains("FIT INVALID") && result.fits.size() > 0 ){
+			result.fits.back().is_valid = false;
+		}
+	}
+
+	log->Debug( Form( "SFFitReader::ReadFile -- Read %lu spectra from %s", m_list_of_results.size(), file_location.Data() ) );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Find the results for a spectrum, labelled "file:histogram" in batch mode. The
+// histogram name alone is enough, so the input files can change between runs,
+// and a file containing a single spectrum matches anything.
+const SFFitReader::SpectrumResult* SFFitReader::GetSpectrumResult( const TString &label ) const {
+	for ( unsigned int i = 0; i < m_list_of_results.size(); ++i ){
+		if ( m_list_of_results.at(i).label == label )return &m_list_of_results.at(i);
+	}
+
+	TString hist_name = ( label.Contains(":") ? TString( label( label.Last(':') + 1, label.Length() ) ) : label );
+	for ( unsigned int i = 0; i < m_list_of_results.size(); ++i ){
+		const TString &l = m_list_of_results.at(i).label;
+		TString other_name = ( l.Contains(":") ? TString( l( l.Last(':') + 1, l.Length() ) ) : l );
+		if ( hist_name != "" && other_name == hist_name )return &m_list_of_results.at(i);
+	}
+
+	if ( m_list_of_results.size() == 1 )return &m_list_of_results.at(0);
+	return nullptr;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Values that were fixed in the config file are left alone, and limits are only
+// tightened where the config file did not give them.
+void SFFitReader::WarmStartSpectrum( SFSpectrum *spec, const TString &label, const double bound_scale ) const {
+	const SpectrumResult *result = GetSpectrumResult( label );
+	if ( result == nullptr ){
+		log->Warning( Form( "SFFitReader::WarmStartSpectrum -- No previous results for %s. Using the usual guesses...", label.Data() ) );
+		return;
+	}
+	if ( result->peaks.size() != spec->GetNumberOfPeaks() ){
+		log->Warning( Form( "SFFitReader::WarmStartSpectrum -- Previous results have %lu peaks, but %u are defined now. Using the usual guesses...", result->peaks.size(), spec->GetNumberOfPeaks() ) );
+		return;
+	}
+
+	// The errors are only worth trusting if every fit converged
+	bool tighten = true;
+	for ( unsigned int i = 0; i < result->fits.size(); ++i ){
+		if ( !result->fits.at(i).is_valid )tighten = false;
+	}
+	if ( !tighten ){
+		log->Warning("SFFitReader::WarmStartSpectrum -- A previous fit was invalid, so its values are used without tightening the limits");
+	}
+
+	// Peaks
+	double lb, ub;
+	bool bound_width_set = false;
+	for ( unsigned int i = 0; i < spec->GetNumberOfPeaks(); ++i ){
+		SFPeak *p = spec->GetPeak(i);
+		const PeakResult &prev = result->peaks.at(i);
+
+		if ( !p->HasFixedAmplitude() ){
+			p->SetAmplitude( prev.amplitude );
+			if ( tighten && GetTightenedLimits( prev.amplitude, prev.amplitude_err, bound_scale, lb, ub ) ){
+				if ( p->GetAmplitudeLB() < 0 )p->SetAmplitudeLB( TMath::Max( lb, 0.0 ) );
+				if ( p->GetAmplitudeUB() < 0 )p->SetAmplitudeUB( ub );
+			}
+		}
+
+		if ( !p->HasFixedMean() ){
+			p->SetMean( prev.mean );
+			if ( tighten && GetTightenedLimits( prev.mean, prev.mean_err, bound_scale, lb, ub ) ){
+				if ( p->GetMeanLB() < 0 )p->SetMeanLB( TMath::Max( lb, 0.0 ) );
+				if ( p->GetMeanUB() < 0 )p->SetMeanUB( ub );
+			}
+		}
+
+		if ( p->HasFixedWidth() )continue;
+
+		// Doublets and unbound peaks are scaled from the common width
+		if ( p->IsDoublet() || p->IsUnbound() ){
+			p->SetWidth( prev.width );
+		}
+		// Bound peaks all share the common width
+		else if ( !bound_width_set && !spec->HasFixedBoundPeakWidth() ){
+			spec->SetBoundPeakWidth( prev.width );
+			if ( tighten && GetTightenedLimits( prev.width, prev.width_err, bound_scale, lb, ub ) ){
+				if ( spec->GetBoundPeakWidthLB() < 0 )spec->SetBoundPeakWidthLB( TMath::Max( lb, 0.0 ) );
+				if ( spec->GetBoundPeakWidthUB() < 0 )spec->SetBoundPeakWidthUB( ub );
+			}
+			bound_width_set = true;
+		}
+	}
+
+	// Backgrounds
+	if ( result->fits.size() != spec->GetNumberOfFits() ){
+		log->Warning( Form( "SFFitReader::WarmStartSpectrum -- Previous results have %lu fits, but %u are defined now. Using the usual background guesses...", result->fits.size(), spec->GetNumberOfFits() ) );
+	}
+	else{
+		for ( unsigned int i = 0; i < spec->GetNumberOfFits(); ++i ){
+			SFFit *fit = spec->GetFit(i);
+			const BackgroundResult &prev = result->fits.at(i);
+
+			for ( unsigned int j = 0; j <= fit->GetBGPolyOrder() && j < prev.bg.size(); ++j ){
+				if ( fit->IsBGPolyFixed(j) )continue;
+				fit->SetBGPoly( j, prev.bg.at(j) );
+				if ( prev.is_valid && tighten && GetTightenedLimits( prev.bg.at(j), prev.bg_err.at(j), bound_scale, lb, ub ) ){
+					if ( fit->GetBGPolyLB(j) == -1.0 )fit->SetBGPolyLB( j, lb );
+					if ( fit->GetBGPolyUB(j) == -1.0 )fit->SetBGPolyUB( j, ub );
+				}
+			}
+		}
+	}
+
+	spec->SetWarmStart( true );
+	log->Debug( Form( "SFFitReader::WarmStartSpectrum -- Starting values for %s taken from previous results", label.Data() ) );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Limits of value +/- bound_scale*error, if the error is usable
+bool SFFitReader::GetTightenedLimits( const double value, const double error, const double bound_scale, double &lb, double &ub ) const {
+	if ( !( error > 0.0 ) || !TMath::Finite( error ) || !TMath::Finite( value ) || bound_scale <= 0.0 ){
+		return false;
+	}
+	lb = value - bound_scale*error;
+	ub = value + bound_scale*error;
+	return true;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Tab-separated fields of a line, without the padding
+std::vector<TString> SFFitReader::SplitLine( const TString &line ) const {
+	std::vector<TString> fields;
+	TObjArray *tokens = line.Tokenize("\t");
+	for ( int i = 0; i < tokens->GetEntries(); ++i ){
+		fields.push_back( ( (TObjString*)tokens->At(i) )->GetString().Strip( TString::kBoth ) );
+	}
+	delete tokens;
+	return fields;
+}
@@ -0,0 +1,133 @@
+#include "FitResult.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+// Mirrors ROOT::Fit::FitResult::FillResult for a minimised likelihood chi-squared
+SFFitResult::SFFitResult( const ROOT::Math::Minimizer &min, const TF1 *fit_func, const bool is_valid, const unsigned int number_of_bins ) : TFitResult(){
+	const unsigned int npar = min.NDim();
+
+	this->SetName( Form( "TFitResult-%s", fit_func->GetName() ) );
+	fMinimType = "Minuit2 / Migrad";
+
+	// Fit quality
+	fValid = is_valid;
+	fNormalized = false;
+	fStatus = min.Status();
+	fCovStatus = min.CovMatrixStatus();
+	fNCalls = min.NCalls();
+	fNFree = min.NFree();
+	fNdf = ( number_of_bins > fNFree ? number_of_bins - fNFree : 0 );
+	fVal = min.MinValue();
+	fEdm = min.Edm();
+	fChi2 = fVal;
+
+	// Parameters, limits and fixed flags
+	fParams.assign( min.X(), min.X() + npar );
+	fErrors.assign( npar, 0.0 );
+	if ( min.Errors() != nullptr ){
+		fErrors.assign( min.Errors(), min.Errors() + npar );
+	}
+
+	fParNames.resize( npar );
+	for ( unsigned int i = 0; i < npar; ++i ){
+		fParNames.at(i) = fit_func->GetParName(i);
+
+		double lb, ub;
+		fit_func->GetParLimits( i, lb, ub );
+		if ( min.IsFixedVariable(i) ){
+			fFixedParams[i] = true;
+		}
+		else if ( lb < ub ){
+			fBoundParams[i] = fParamBounds.size();
+			fParamBounds.push_back( std::make_pair( lb, ub ) );
+		}
+	}
+
+	// Covariance matrix (lower triangle, fixed parameters are zero)
+	if ( fCovStatus != 0 ){
+		fCovMatrix.resize( npar*( npar + 1 )/2 );
+		for ( unsigned int i = 0; i < npar; ++i ){
+			for ( unsigned int j = 0; j <= i; ++j ){
+				fCovMatrix.at( j + i*( i + 1 )/2 ) = min.CovMatrix( i, j );
+			}
+		}
+	}
+
+	log->Construction("SFFitResult::SFFitResult -- SFFitResult object constructed");
+}
+///////////////////////////////////////////////////////////////////////////////
+// Empty result, to be filled by Read
+SFFitResult::SFFitResult( const TF1 *fit_func ) : TFitResult(){
+	this->SetName( Form( "TFitResult-%s", fit_func->GetName() ) );
+	fMinimType = "Minuit2 / Migrad";
+	fValid = false;
+	fNormalized = false;
+
+	log->Construction("SFFitResult::SFFitResult -- SFFitResult object constructed");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFFitResult::~SFFitResult(){
+	log->Construction("SFFitResult::~SFFitResult -- SFFitResult object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+// Fit quality on the first two lines, then one line per parameter and the
+// covariance matrix (lower triangle) on the last line
+void SFFitResult::WriteText( std::ostream &out ) const {
+	out << std::setprecision( std::numeric_limits<double>::max_digits10 );
+	out << fValid << " " << fStatus << " " << fCovStatus << " " << fNCalls << " " << fNFree << " " << fNdf << std::endl;
+	out << fVal << " " << fEdm << std::endl;
+
+	out << fParams.size() << std::endl;
+	for ( unsigned int i = 0; i < fParams.size(); ++i ){
+		double lb = 0.0, ub = 0.0;
+		bool is_bound = ( fBoundParams.find(i) != fBoundParams.end() );
+		if ( is_bound ){
+			lb = fParamBounds.at( fBoundParams.at(i) ).first;
+			ub = fParamBounds.at( fBoundParams.at(i) ).second;
+		}
+		out << fParNames.at(i) << " " << fParams.at(i) << " " << fErrors.at(i) << " " << IsParameterFixed(i) << " " << is_bound << " " << lb << " " << ub << std::endl;
+	}
+
+	out << fCovMatrix.size();
+	for ( unsigned int i = 0; i < fCovMatrix.size(); ++i ){
+		out << " " << fCovMatrix.at(i);
+	}
+	out << std::endl;
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Returns false if the input is not a complete result
+bool SFFitResult::ReadText( std::istream &in ){
+	unsigned int npar = 0, ncov = 0;
+	in >> fValid >> fStatus >> fCovStatus >> fNCalls >> fNFree >> fNdf;
+	in >> fVal >> fEdm;
+	in >> npar;
+	if ( !in.good() )return false;
+	fChi2 = fVal;
+
+	fParams.assign( npar, 0.0 );
+	fErrors.assign( npar, 0.0 );
+	fParNames.assign( npar, "" );
+	fFixedParams.clear();
+	fBoundParams.clear();
+	fParamBounds.clear();
+	for ( unsigned int i = 0; i < npar; ++i ){
+		bool is_fixed, is_bound;
+		double lb, ub;
+		in >> fParNames.at(i) >> fParams.at(i) >> fErrors.at(i) >> is_fixed >> is_bound >> lb >> ub;
+		if ( is_fixed ){
+			fFixedParams[i] = true;
+		}
+		else if ( is_bound ){
+			fBoundParams[i] = fParamBounds.size();
+			fParamBounds.push_back( std::make_pair( lb, ub ) );
+		}
+	}
+
+	in >> ncov;
+	if ( !in.good() || ( ncov != 0 && ncov != npar*( npar + 1 )/2 ) )return false;
+	fCovMatrix.assign( ncov, 0.0 );
+	for ( unsigned int i = 0; i < ncov; ++i ){
+		in >> fCovMatrix.at(i);
+	}
+	return !in.fail();
+}
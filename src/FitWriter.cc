@@ -3,6 +3,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 SFFitWriter::SFFitWriter(){
 	m_file_location = "";
+	m_spectrum_label = "";
+	m_append_mode = false;
 	m_spec = nullptr;
 	log->Construction("SFFitWriter::SFFitWriter -- SFFitWriter object constructed");
 }
@@ -17,13 +19,19 @@ void SFFitWriter::WriteFits(){
 	if ( m_file_location == "" ){
 		log->Error("File location for fit parameter output file needs to be set!");
 	}
-	m_output_file.open( m_file_location );
+	m_output_file.open( m_file_location, ( m_append_mode ? std::ios::app : std::ios::trunc ) | std::ios::out );
 
 	// Check the file opened
 	if ( !m_output_file.is_open() ){
 		log->Error( Form( "Failed attempt at opening fit parameter output file at %s", m_file_location.Data() ) );
 	}
 
+	// Say which spectrum the block belongs to when fitting more than one
+	if ( m_spectrum_label != "" ){
+		if ( m_append_mode )m_output_file << std::endl;
+		m_output_file << "# Spectrum: " << m_spectrum_label << std::endl;
+	}
+
 	// Write a header
 	m_output_file << std::left << 
 		std::setw(m_item_width) << "Peak num" << "\t" <<
@@ -116,7 +124,9 @@ void SFFitWriter::WriteFits(){
 		for ( unsigned int j = 0; j <= fit->GetBGPolyOrder(); ++j ){
 			m_output_file << std::setprecision(m_item_width) << std::setw(m_item_width) << fit->GetBGPoly(j) << "\t" << std::setw(m_item_width) << fit->GetBGPolyErr(j) << "\t" << std::setw(m_item_width) << fit->GetBGInfoString() << "\t";
 		}
-		m_output_file << "Red. chi-sq." << "\t" << std::setprecision(6) << std::setw(m_item_width) << fit->GetReducedChiSquared() << std::endl;
+		m_output_file << "Red. chi-sq." << "\t" << std::setprecision(6) << std::setw(m_item_width) << fit->GetReducedChiSquared() << "\t";
+		WriteTelemetry( fit );
+		m_output_file << std::endl;
 		
 		if ( !fit->GetFitResultPtr()->IsValid() ){
 			m_output_file << std::left;
@@ -136,6 +146,23 @@ void SFFitWriter::WriteFits(){
 	return;
 }
 ///////////////////////////////////////////////////////////////////////////////
+// Minimiser status and work done, after the chi-squared so that SFFitReader
+// still finds the background terms
+void SFFitWriter::WriteTelemetry( SFFit *fit ){
+	const SFFit::FitTelemetry &t = fit->GetTelemetry();
+	TFitResultPtr r = fit->GetFitResultPtr();
+	m_output_file << std::left <<
+		"Status" << "\t" << r->Status() << "\t" <<
+		"Cov. status" << "\t" << r->CovMatrixStatus() << "\t" <<
+		"EDM" << "\t" << std::setprecision(3) << r->Edm() << "\t" <<
+		"Iterations" << "\t" << t.iterations << "\t" <<
+		"Values" << "\t" << t.evaluations << "\t" <<
+		"Gradients" << "\t" << t.gradients << "\t" <<
+		"Time (s)" << "\t" << t.time << "\t" <<
+		"Cached" << "\t" << t.cached << std::setprecision(6);
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
 void SFFitWriter::WritePeakInformation( SFPeak* peak, unsigned int i ){
 	m_output_file << std::left << 
 		std::setw(m_item_width) << Form( "P.%02d", i ) << "\t" <<
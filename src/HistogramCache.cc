@@ -0,0 +1,141 @@
+#include "HistogramCache.hh"
+
+SFHistogramCache* SFHistogramCache::m_instance_ptr = nullptr;
+
+///////////////////////////////////////////////////////////////////////////////
+SFHistogramCache::SFHistogramCache(){
+	m_memory_used = 0.0;
+	m_memory_limit = 512.0*1024*1024;
+	m_maximum_open_files = 16;
+	log->Construction("SFHistogramCache::SFHistogramCache -- SFHistogramCache object created");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFHistogramCache::~SFHistogramCache(){
+	this->Clear();
+	if ( m_instance_ptr == this )m_instance_ptr = nullptr;
+	log->Construction("SFHistogramCache::~SFHistogramCache -- SFHistogramCache object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFHistogramCache::Clear(){
+	std::lock_guard<std::mutex> lock( m_mutex );
+	CloseFiles(0);
+	DropHistograms(0.0);
+	m_names.clear();
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Opens the file if it is not open already, and moves it to the front of the queue
+TFile* SFHistogramCache::GetFile( const TString &file_name ){
+	auto it = m_files.find( file_name );
+	if ( it != m_files.end() ){
+		m_file_order.splice( m_file_order.begin(), m_file_order, it->second.used );
+		return it->second.file;
+	}
+
+	TFile *f = new TFile( file_name.Data() );
+	if ( f->IsZombie() ){
+		delete f;
+		return nullptr;
+	}
+
+	// Leave room for this one
+	CloseFiles( m_maximum_open_files > 0 ? m_maximum_open_files - 1 : 0 );
+	m_file_order.push_front( file_name );
+	m_files[file_name] = { f, m_file_order.begin() };
+	log->Debug( Form( "SFHistogramCache::GetFile -- Opened %s (%lu open)", file_name.Data(), m_files.size() ) );
+	return f;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Close the least recently used files until only n are open
+void SFHistogramCache::CloseFiles( const unsigned int n ){
+	while ( m_files.size() > n ){
+		auto it = m_files.find( m_file_order.back() );
+		it->second.file->Close();
+		delete it->second.file;
+		m_files.erase( it );
+		m_file_order.pop_back();
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Drop the least recently used histograms until they take up no more than limit
+void SFHistogramCache::DropHistograms( const double limit ){
+	while ( m_hists.size() > 0 && m_memory_used > limit ){
+		auto it = m_hists.find( m_hist_order.back() );
+		m_memory_used -= it->second.size;
+		m_hists.erase( it );
+		m_hist_order.pop_back();
+	}
+	if ( m_hists.size() == 0 )m_memory_used = 0.0;
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+bool SFHistogramCache::GetHistogramNames( const TString &file_name, std::vector<TString> &names ){
+	std::lock_guard<std::mutex> lock( m_mutex );
+	names.resize(0);
+
+	auto it = m_names.find( file_name );
+	if ( it != m_names.end() ){
+		names = it->second;
+		return true;
+	}
+
+	TFile *f = GetFile( file_name );
+	if ( f == nullptr )return false;
+
+	TIter next( f->GetListOfKeys() );
+	TKey *key = nullptr;
+	while ( ( key = (TKey*)next() ) ){
+		TClass *c = TClass::GetClass( key->GetClassName() );
+		if ( c == nullptr || !c->InheritsFrom("TH1") )continue;
+
+		// Only take the highest cycle of each key
+		TString name = key->GetName();
+		if ( std::find( names.begin(), names.end(), name ) != names.end() )continue;
+		names.push_back( name );
+	}
+	m_names[file_name] = names;
+	return true;
+}
+///////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<const TH1> SFHistogramCache::GetHistogram( const TString &file_name, const TString &hist_name ){
+	std::lock_guard<std::mutex> lock( m_mutex );
+	const TString label = file_name + ":" + hist_name;
+
+	auto it = m_hists.find( label );
+	if ( it != m_hists.end() ){
+		m_hist_order.splice( m_hist_order.begin(), m_hist_order, it->second.used );
+		return it->second.hist;
+	}
+
+	TFile *f = GetFile( file_name );
+	if ( f == nullptr )return nullptr;
+
+	// Anything that is not kept is ours to delete
+	TObject *o = f->Get( hist_name.Data() );
+	TH1 *h = dynamic_cast<TH1*>( o );
+	if ( h == nullptr ){
+		delete o;
+		return nullptr;
+	}
+	if ( h->GetDimension() != 1 ){
+		log->Warning( Form( "SFHistogramCache::GetHistogram -- %s is not a 1D histogram", label.Data() ) );
+		delete h;
+		return nullptr;
+	}
+	h->SetDirectory(0); // Decouple from ROOT file
+
+	// The bin contents (in their own type) and errors (if stored), plus the bin edges
+	const double n = h->GetNbinsX() + 2;
+	const unsigned int content_size = SFBinView::GetContentSize( SFBinView(h).GetContentType() );
+	double size = sizeof(TH1D) + n*content_size + ( h->GetSumw2N() > 0 ? n*sizeof(double) : 0 ) + n*sizeof(double);
+
+	// Make room for it, but keep it even if it is bigger than the limit
+	DropHistograms( TMath::Max( m_memory_limit - size, 0.0 ) );
+	m_hist_order.push_front( label );
+	m_hists[label] = { std::shared_ptr<const TH1>(h), size, m_hist_order.begin() };
+	m_memory_used += size;
+
+	log->Debug( Form( "SFHistogramCache::GetHistogram -- Read %s (%lu cached, %.1f MB)", label.Data(), m_hists.size(), m_memory_used/( 1024.0*1024.0 ) ) );
+	return m_hists[label].hist;
+}
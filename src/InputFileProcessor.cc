@@ -7,99 +7,314 @@ InputFileProcessor::InputFileProcessor(){
 	m_sf = nullptr;
 	m_sd = nullptr;
 	m_fw = nullptr;
+	m_config = nullptr;
+	m_fit_reader = nullptr;
+	m_fit_cache = nullptr;
 	log->Construction("InputFileProcessor::InputFileProcessor() -- InputFileProcessor object constructed");
 }
 ///////////////////////////////////////////////////////////////////////////////
 InputFileProcessor::~InputFileProcessor(){
+	delete m_config;
+	delete m_fit_reader;
+	delete m_fit_cache;
 	log->Construction("InputFileProcessor::InputFileProcessor() -- InputFileProcessor object destroyed");
 }
 ///////////////////////////////////////////////////////////////////////////////
 void InputFileProcessor::ProcessOptions(){
-	// Create TEnv object for processing the input file
-	TEnv *config = new TEnv( m_input_file_location.Data() );
+	// Create TEnv object for processing the input file (replacing any from an earlier call)
+	delete m_config;
+	m_config = new TEnv( m_input_file_location.Data() );
 
-	// Get the ROOT file
-	TString s = (TString)config->GetValue( "ROOTFile", "" );
-	if ( s == "" ){
-		log->Error("Could not find \"ROOTFile\" in the input file. Please specify!");
+	// Files and histograms are kept open between jobs, up to these limits
+	SFHistogramCache *histogram_cache = SFHistogramCache::GetInstance();
+	histogram_cache->SetMemoryLimit( m_config->GetValue( "HistogramCacheSize", 512.0 ) );
+	histogram_cache->SetMaximumOpenFiles( m_config->GetValue( "MaximumOpenFiles", 16 ) );
+
+	// Read all of the histograms that are to be fitted
+	FindHistograms();
+
+	// Set the output file location for fit parameters
+	if ( m_fw != nullptr ){
+		m_fw->SetFileLocation( m_config->GetValue( "FitParameterFile", "FIT_PARAMETER_FILE.dat") );
+	}
+	else{
+		log->Error("FitWriter object not initialised");
+	}
+
+	// Results of a previous run to start the fits from
+	TString warm_start_file = m_config->GetValue( "WarmStartFile", "" );
+	delete m_fit_reader;
+	m_fit_reader = nullptr;
+	if ( warm_start_file != "" ){
+		m_fit_reader = new SFFitReader();
+		m_fit_reader->ReadFile( warm_start_file );
 	}
 
-	// Open the TFile
-	TFile *f = new TFile( s.Data() );
+	// SPECTRUM OPTIONS (the first histogram -- any others are set up by SFBatchFitter)
+	ProcessSpectrumOptions( 0, m_spec );
 
-	// Test if the ROOT file opened
-	if ( f->IsZombie() ){
-		log->Error( Form( "File containing histogram(s) not found! Tried to open %s.", s.Data() ) );
+	// SPECTRUM FITTER OPTIONS
+	TString fit_cache_directory = m_config->GetValue( "FitCacheDirectory", "" );
+	delete m_fit_cache;
+	m_fit_cache = nullptr;
+	if ( fit_cache_directory != "" ){
+		m_fit_cache = new SFFitCache( fit_cache_directory );
 	}
 
-	// Get the histogram
-	s = (TString)config->GetValue( "ROOTHistName", "" );
-	TH1F *h = nullptr;
+	if ( m_sf == nullptr ){
+		log->Warning("SpectrumFitter not initialised!");
+	}
+	else{
+		m_sf->SetFitCache( m_fit_cache );
+	}
 
-	// See if you can get the histogram
-	if ( f->IsOpen() && !s.EqualTo("") ){
-		h = (TH1F*)f->Get( s.Data() );
-		h->SetDirectory(0); // Decouple from ROOT file
+	// SPECTRUM DRAWER OPTIONS
+	ProcessDrawerOptions( 0, m_sd );
+
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// ROOTFile and ROOTHistName can both hold a list separated by spaces or commas.
+// File names can use shell wildcards, and histogram names can use wildcards
+// (e.g. "run_*") or a regular expression between slashes (e.g. "/run_[0-9]+/").
+// RawFile and ASCIIFile are lists of files holding one spectrum each, read
+// without ROOT (see SFSpectrumLoader). Every histogram found is fitted with the
+// same peaks, fits and integrals.
+void InputFileProcessor::FindHistograms(){
+	SFHistogramCache *histogram_cache = SFHistogramCache::GetInstance();
+	m_hist_list.resize(0);
+	m_hist_label_list.resize(0);
+	m_hist_tag_list.resize(0);
+
+	// Get the ROOT file(s)
+	TString s = (TString)m_config->GetValue( "ROOTFile", "" );
+	TString raw_files = (TString)m_config->GetValue( "RawFile", "" );
+	TString ascii_files = (TString)m_config->GetValue( "ASCIIFile", "" );
+	if ( s == "" && raw_files == "" && ascii_files == "" ){
+		log->Error("Could not find \"ROOTFile\", \"RawFile\" or \"ASCIIFile\" in the input file. Please specify!");
 	}
+	std::vector<TString> file_list = ExpandFileNames( SplitList(s) );
 
-	// Create the spectrum
-	if ( h != nullptr ){
-		if ( m_spec == nullptr ){
-			log->Error("UNSPECIFIED");
+	// Get the histogram name(s)
+	s = (TString)m_config->GetValue( "ROOTHistName", "" );
+	if ( s == "" && file_list.size() > 0 ){
+		log->Error("Could not find \"ROOTHistName\" in the input file. Please specify!");
+	}
+	std::vector<TString> hist_name_list = SplitList(s);
+
+	for ( unsigned int i = 0; i < file_list.size(); ++i ){
+		// Prefix for the output files if there is more than one input file
+		TString file_tag = "";
+		if ( file_list.size() > 1 ){
+			file_tag = gSystem->BaseName( file_list.at(i).Data() );
+			if ( file_tag.EndsWith(".root") )file_tag.Remove( file_tag.Length() - 5 );
+			file_tag.Append("_");
 		}
-		else if ( m_spec->GetHist() == nullptr ){
-			m_spec->SetHist( h );
+
+		for ( unsigned int j = 0; j < hist_name_list.size(); ++j ){
+			std::vector<TString> names = MatchHistogramNames( file_list.at(i), hist_name_list.at(j) );
+
+			// Get the histograms
+			for ( unsigned int k = 0; k < names.size(); ++k ){
+				std::shared_ptr<const TH1> h = histogram_cache->GetHistogram( file_list.at(i), names.at(k) );
+				if ( h == nullptr ){
+					log->Warning( Form( "Histogram %s not found in %s. Skipping...", names.at(k).Data(), file_list.at(i).Data() ) );
+					continue;
+				}
+
+				TString tag = file_tag + names.at(k);
+				tag.ReplaceAll( "/", "_" );
+				m_hist_list.push_back( SFBinView(h) );
+				m_hist_label_list.push_back( file_list.at(i) + ":" + names.at(k) );
+				m_hist_tag_list.push_back( tag );
+			}
 		}
 	}
 
-	// Set the output file location for fit parameters
-	if ( m_fw != nullptr ){
-		m_fw->SetFileLocation( config->GetValue( "FitParameterFile", "FIT_PARAMETER_FILE.dat") );
+	// Raw binary and text files
+	if ( raw_files != "" || ascii_files != "" ){
+		SFSpectrumLoader loader;
+		ProcessLoaderOptions( loader );
+		LoadHistograms( loader, ExpandFileNames( SplitList( raw_files ) ), true );
+		LoadHistograms( loader, ExpandFileNames( SplitList( ascii_files ) ), false );
 	}
-	else{
-		log->Error("FitWriter object not initialised");
+
+	if ( m_hist_list.size() == 0 ){
+		log->Error("No histograms were found in \"ROOTFile\", \"RawFile\" or \"ASCIIFile\"");
 	}
+	log->Debug( Form( "InputFileProcessor::FindHistograms -- Found %lu histogram(s) to fit", m_hist_list.size() ) );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void InputFileProcessor::ProcessLoaderOptions( SFSpectrumLoader &loader ) const {
+	SFSpectrumLoader::DataType type;
+	TString s = m_config->GetValue( "RawDataType", "uint32" );
+	s.ToLower();
+	if ( !SFSpectrumLoader::GetDataType( s, type ) ){
+		log->Error( Form( "RawDataType must be int8, uint8, int16, uint16, int32, uint32, int64, uint64, float or double, not \"%s\"", s.Data() ) );
+	}
+	loader.SetDataType( type );
+
+	s = m_config->GetValue( "RawByteOrder", "little" );
+	s.ToLower();
+	if ( s != "little" && s != "big" ){
+		log->Error( Form( "RawByteOrder must be \"little\" or \"big\", not \"%s\"", s.Data() ) );
+	}
+	loader.SetBigEndian( s == "big" );
+
+	int header_size = m_config->GetValue( "RawHeaderSize", 0 );
+	int number_of_bins = m_config->GetValue( "RawNumberOfBins", 0 );
+	if ( header_size < 0 || number_of_bins < 0 ){
+		log->Error("RawHeaderSize and RawNumberOfBins cannot be negative");
+	}
+	loader.SetHeaderSize( header_size );
+	loader.SetNumberOfBins( number_of_bins );
+
+	double bin_width = m_config->GetValue( "SpectrumBinWidth", 1.0 );
+	if ( bin_width <= 0.0 ){
+		log->Error("SpectrumBinWidth must be positive");
+	}
+	loader.SetLB( m_config->GetValue( "SpectrumLB", 0.0 ) );
+	loader.SetBinWidth( bin_width );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Each file is one spectrum, named after the file without its extension. Its
+// view keeps the mapped file or the numbers read alive.
+void InputFileProcessor::LoadHistograms( const SFSpectrumLoader &loader, const std::vector<TString> &file_list, const bool binary ){
+	for ( unsigned int i = 0; i < file_list.size(); ++i ){
+		TString name = gSystem->BaseName( file_list.at(i).Data() );
+		Ssiz_t dot = name.Last('.');
+		if ( dot > 0 )name.Remove( dot );
+
+		SFBinView view;
+		if ( !( binary ? loader.ReadBinary( file_list.at(i), view ) : loader.ReadASCII( file_list.at(i), view ) ) ){
+			log->Error( Form( "Could not read a spectrum from %s", file_list.at(i).Data() ) );
+			continue;
+		}
+
+		m_hist_list.push_back( view );
+		m_hist_label_list.push_back( file_list.at(i) + ":" + name );
+		m_hist_tag_list.push_back( name );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Names of the histograms in a file that match the given name or pattern. Plain
+// names are returned as they are, so that a missing histogram can be reported.
+std::vector<TString> InputFileProcessor::MatchHistogramNames( const TString &file_name, const TString &pattern ) const {
+	std::vector<TString> names;
+	std::vector<TString> file_names;
+	if ( !SFHistogramCache::GetInstance()->GetHistogramNames( file_name, file_names ) ){
+		log->Error( Form( "File containing histogram(s) not found! Tried to open %s.", file_name.Data() ) );
+		return names;
+	}
+
+	bool is_regexp = ( pattern.Length() > 2 && pattern.BeginsWith("/") && pattern.EndsWith("/") );
+	bool is_wildcard = ( pattern.Contains("*") || pattern.Contains("?") || pattern.Contains("[") );
 
-	// SPECTRUM OPTIONS
-	if ( m_spec != nullptr ){
-		int number_of_peaks = config->GetValue( "NumberOfPeaks", 0 );
-		m_spec->SetNumberOfFits( config->GetValue( "NumberOfFits", 0 ) );
-		m_spec->SetNumberOfIntegrals( config->GetValue( "NumberOfIntegrals", 0 ) );
-		m_spec->SetSeparationEnergy( config->GetValue( "SeparationEnergy", -1.0 ) );
+	if ( !is_regexp && !is_wildcard ){
+		names.push_back( pattern );
+		return names;
+	}
 
-		if ( m_spec->GetSeparationEnergy() == -1.0 ){
+	// Whole name must match
+	TString expression = ( is_regexp ? TString( pattern( 1, pattern.Length() - 2 ) ) : pattern );
+	TRegexp regexp( expression, !is_regexp );
+	for ( unsigned int i = 0; i < file_names.size(); ++i ){
+		Ssiz_t length = 0;
+		if ( regexp.Index( file_names.at(i), &length ) != 0 || length != file_names.at(i).Length() )continue;
+		names.push_back( file_names.at(i) );
+	}
+
+	if ( names.size() == 0 ){
+		log->Warning( Form( "No histograms match %s in %s", pattern.Data(), file_name.Data() ) );
+	}
+	return names;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Expand any file names containing shell wildcards
+std::vector<TString> InputFileProcessor::ExpandFileNames( const std::vector<TString> &list ) const {
+	std::vector<TString> files;
+	for ( unsigned int i = 0; i < list.size(); ++i ){
+		if ( !list.at(i).Contains("*") && !list.at(i).Contains("?") && !list.at(i).Contains("[") ){
+			files.push_back( list.at(i) );
+			continue;
+		}
+
+		glob_t matches;
+		if ( glob( list.at(i).Data(), 0, nullptr, &matches ) == 0 ){
+			for ( size_t j = 0; j < matches.gl_pathc; ++j ){
+				files.push_back( matches.gl_pathv[j] );
+			}
+		}
+		else{
+			log->Warning( Form( "No files match %s", list.at(i).Data() ) );
+		}
+		globfree( &matches );
+	}
+	return files;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Split a config value into the items separated by spaces or commas
+std::vector<TString> InputFileProcessor::SplitList( const TString &s ) const {
+	std::vector<TString> list;
+	TObjArray *tokens = s.Tokenize(" \t,");
+	for ( int i = 0; i < tokens->GetEntries(); ++i ){
+		list.push_back( ( (TObjString*)tokens->At(i) )->GetString() );
+	}
+	delete tokens;
+	return list;
+}
+///////////////////////////////////////////////////////////////////////////////
+void InputFileProcessor::ProcessSpectrumOptions( const unsigned int n, SFSpectrum *spec ){
+	if ( spec != nullptr ){
+		// Each spectrum views the bins of its histogram, which are shared rather than copied
+		if ( n >= m_hist_list.size() ){
+			log->Error( Form( "InputFileProcessor::ProcessSpectrumOptions -- Asked for histogram %u, but only %lu were found", n, m_hist_list.size() ) );
+		}
+		if ( spec->GetNumberOfBins() == 0 ){
+			spec->SetBinView( m_hist_list.at(n), m_hist_tag_list.at(n) );
+		}
+
+		int number_of_peaks = m_config->GetValue( "NumberOfPeaks", 0 );
+		spec->SetNumberOfFits( m_config->GetValue( "NumberOfFits", 0 ) );
+		spec->SetNumberOfIntegrals( m_config->GetValue( "NumberOfIntegrals", 0 ) );
+		spec->SetSeparationEnergy( m_config->GetValue( "SeparationEnergy", -1.0 ) );
+
+		if ( spec->GetSeparationEnergy() == -1.0 ){
 			log->Warning( "No separation energy specified...I have no way of knowing if the peaks are supposed to be unbound or not! Assuming all bound.");
 		}
 		
 		// Set fit options
-		int bg_dim = config->GetValue( "BackgroundDimension", 0 );
-		for ( unsigned int i = 0; i < m_spec->GetNumberOfFits(); ++i ){
-			SFFit *fit = m_spec->GetFit(i);
+		int bg_dim = m_config->GetValue( "BackgroundDimension", 0 );
+		for ( unsigned int i = 0; i < spec->GetNumberOfFits(); ++i ){
+			SFFit *fit = spec->GetFit(i);
 			fit->SetBGPolyOrder( bg_dim );
-			fit->SetFitLimitLB( config->GetValue( Form( "%02d.FitLB", i ), -1.0 ) );
-			fit->SetFitLimitUB( config->GetValue( Form( "%02d.FitUB", i ), -1.0 ) );
+			fit->SetFitLimitLB( m_config->GetValue( Form( "%02d.FitLB", i ), -1.0 ) );
+			fit->SetFitLimitUB( m_config->GetValue( Form( "%02d.FitUB", i ), -1.0 ) );
 			
 			// Background parameters
 			for ( int j = 0; j <= bg_dim; ++j ){
-				fit->SetBGPoly( j, config->GetValue( Form( "%02d.Background", j ), -1.0 ) );
-				fit->SetBGPolyLB( j, config->GetValue( Form( "%02d.Background_LB", j ), -1.0 ) );
-				fit->SetBGPolyUB( j, config->GetValue( Form( "%02d.Background_UB", j ), -1.0 ) );
-				fit->SetBGPolyFixed( j, config->GetValue( Form( "%02d.Background_fixed", j ), false ) );
+				fit->SetBGPoly( j, m_config->GetValue( Form( "%02d.Background", j ), -1.0 ) );
+				fit->SetBGPolyLB( j, m_config->GetValue( Form( "%02d.Background_LB", j ), -1.0 ) );
+				fit->SetBGPolyUB( j, m_config->GetValue( Form( "%02d.Background_UB", j ), -1.0 ) );
+				fit->SetBGPolyFixed( j, m_config->GetValue( Form( "%02d.Background_fixed", j ), false ) );
 			}
 		}
 
 		// Set integral options
-		for ( unsigned int i = 0; i < m_spec->GetNumberOfIntegrals(); ++i ){
-			SFSpectrumIntegral *integral = m_spec->GetIntegral(i);
-			integral->SetIntegralLB( config->GetValue( Form( "%02d.Integral_LB", i ), -1.0 ) );
-			integral->SetIntegralUB( config->GetValue( Form( "%02d.Integral_UB", i ), -1.0 ) );
+		for ( unsigned int i = 0; i < spec->GetNumberOfIntegrals(); ++i ){
+			SFSpectrumIntegral *integral = spec->GetIntegral(i);
+			integral->SetIntegralLB( m_config->GetValue( Form( "%02d.Integral_LB", i ), -1.0 ) );
+			integral->SetIntegralUB( m_config->GetValue( Form( "%02d.Integral_UB", i ), -1.0 ) );
 
 			if ( integral->GetIntegralLB() == integral->GetIntegralUB() ){
 				log->Warning("Integral cannot have same LB as UB. The limits must be specified! Disregarding...");
 			}
 			else{
-				double Y1 = config->GetValue( Form( "%02d.IntegralY1", i ), -1.0 );
-				double Y2 = config->GetValue( Form( "%02d.IntegralY2", i ), -1.0 );
+				double Y1 = m_config->GetValue( Form( "%02d.IntegralY1", i ), -1.0 );
+				double Y2 = m_config->GetValue( Form( "%02d.IntegralY2", i ), -1.0 );
 
 				if ( Y1 != -1.0 && Y2 != -1.0 ){
 					// Background set, so calculate linear parameters
@@ -121,50 +336,56 @@ void InputFileProcessor::ProcessOptions(){
 					// Set integral background from fit
 					integral->SetBackgroundFromCoordinates( false );
 					integral->SetBGPolyOrder( bg_dim );
-					int parent_fit = config->GetValue( Form( "%02d.IntegralFitNumber", i ), -1 );
-					if ( parent_fit < 0 || parent_fit > (int)m_spec->GetNumberOfFits() ){
+					int parent_fit = m_config->GetValue( Form( "%02d.IntegralFitNumber", i ), -1 );
+					if ( parent_fit < 0 || parent_fit > (int)spec->GetNumberOfFits() ){
 						log->Warning("Selected fit outside range. Choosing the first fit as source of background.");
 						parent_fit = 0;
 					}
-					integral->SetParentFit( m_spec->GetFit( parent_fit ) );
+					integral->SetParentFit( spec->GetFit( parent_fit ) );
 
 				}
 			}
 		}
 
 		// Guesses for fitting
-		m_spec->SetGuessWidth( config->GetValue( "GuessWidth", 100.0 ) );
-		m_spec->SetGuessWidthLB( config->GetValue( "GuessWidth_LB", 50.0 ) );
-		m_spec->SetGuessWidthUB( config->GetValue( "GuessWidth_UB", 150.0 ) );
-		m_spec->SetGuessAmplitudeFractionLB( config->GetValue( "GuessAmplitudeFraction_LB", 0.0 ) );
-		m_spec->SetGuessAmplitudeFractionUB( config->GetValue( "GuessAmplitudeFraction_UB", 1.2 ) );
-		m_spec->SetGuessMeanHalfWidth( config->GetValue( "GuessMeanHalfWidth", 100.0 ) );
+		spec->SetGuessWidth( m_config->GetValue( "GuessWidth", 100.0 ) );
+		spec->SetGuessWidthLB( m_config->GetValue( "GuessWidth_LB", 50.0 ) );
+		spec->SetGuessWidthUB( m_config->GetValue( "GuessWidth_UB", 150.0 ) );
+		spec->SetGuessAmplitudeFractionLB( m_config->GetValue( "GuessAmplitudeFraction_LB", 0.0 ) );
+		spec->SetGuessAmplitudeFractionUB( m_config->GetValue( "GuessAmplitudeFraction_UB", 1.2 ) );
+		spec->SetGuessMeanHalfWidth( m_config->GetValue( "GuessMeanHalfWidth", 100.0 ) );
+		spec->SetPeakSearch( m_config->GetValue( "PeakSearch", false ) );
+		spec->SetPeakSearchThreshold( m_config->GetValue( "PeakSearchThreshold", 5.0 ) );
+		spec->SetPeakEvaluationRange( m_config->GetValue( "PeakEvaluationRange", 8.0 ) );
+		spec->SetVariableProjection( m_config->GetValue( "VariableProjection", false ) );
+		spec->SetFitClusterSeparation( m_config->GetValue( "FitClusterSeparation", 0.0 ) );
+		spec->SetFitClusterJointWidth( m_config->GetValue( "FitClusterJointWidth", false ) );
 		
 		// Bound peak widths
-		m_spec->SetBoundPeakWidth( config->GetValue( "BoundPeakWidth", -1.0 ) );
-		m_spec->SetBoundPeakWidthLB( config->GetValue( "BoundPeakWidth_LB", -1.0 ) );
-		m_spec->SetBoundPeakWidthUB( config->GetValue( "BoundPeakWidth_UB", -1.0 ) );
-		m_spec->SetFixedBoundPeakWidth( config->GetValue( "BoundPeakWidth_fixed", false ) );
+		spec->SetBoundPeakWidth( m_config->GetValue( "BoundPeakWidth", -1.0 ) );
+		spec->SetBoundPeakWidthLB( m_config->GetValue( "BoundPeakWidth_LB", -1.0 ) );
+		spec->SetBoundPeakWidthUB( m_config->GetValue( "BoundPeakWidth_UB", -1.0 ) );
+		spec->SetFixedBoundPeakWidth( m_config->GetValue( "BoundPeakWidth_fixed", false ) );
 
 		// Store peak options
 		for ( int i = 0; i < number_of_peaks; ++i ){
 			SFPeak *p = new SFPeak();
 
-			p->SetAmplitude( config->GetValue( Form( "%02d.Amplitude", i ), -1.0 ) );
-			p->SetAmplitudeLB( config->GetValue( Form( "%02d.Amplitude_LB", i ), -1.0 ) );
-			p->SetAmplitudeUB( config->GetValue( Form( "%02d.Amplitude_UB", i ), -1.0 ) );
-			p->SetFixedAmplitude( config->GetValue( Form( "%02d.Amplitude_fixed", i ), false ) );
+			p->SetAmplitude( m_config->GetValue( Form( "%02d.Amplitude", i ), -1.0 ) );
+			p->SetAmplitudeLB( m_config->GetValue( Form( "%02d.Amplitude_LB", i ), -1.0 ) );
+			p->SetAmplitudeUB( m_config->GetValue( Form( "%02d.Amplitude_UB", i ), -1.0 ) );
+			p->SetFixedAmplitude( m_config->GetValue( Form( "%02d.Amplitude_fixed", i ), false ) );
 
-			p->SetMean( config->GetValue( Form( "%02d.Mean", i ), -1.0 ) );
+			p->SetMean( m_config->GetValue( Form( "%02d.Mean", i ), -1.0 ) );
 			if ( p->GetMean() == -1 ){
 				log->Warning( Form( "Peak %02d did not have a mean assigned. Is this a mistake?", i ) );
 			}
-			p->SetMeanLB( config->GetValue( Form( "%02d.Mean_LB", i ), -1.0 ) );
-			p->SetMeanUB( config->GetValue( Form( "%02d.Mean_UB", i ), -1.0 ) );
-			p->SetFixedMean( config->GetValue( Form( "%02d.Mean_fixed", i ), false ) );
+			p->SetMeanLB( m_config->GetValue( Form( "%02d.Mean_LB", i ), -1.0 ) );
+			p->SetMeanUB( m_config->GetValue( Form( "%02d.Mean_UB", i ), -1.0 ) );
+			p->SetFixedMean( m_config->GetValue( Form( "%02d.Mean_fixed", i ), false ) );
 
 			// Decide if it's bound or unbound
-			if ( m_spec->GetSeparationEnergy() == -1 || p->GetMean() < m_spec->GetSeparationEnergy() ){
+			if ( spec->GetSeparationEnergy() == -1 || p->GetMean() < spec->GetSeparationEnergy() ){
 				p->SetBound();
 			}
 			else{
@@ -172,10 +393,10 @@ void InputFileProcessor::ProcessOptions(){
 			}
 
 			// Doublets
-			if( config->GetValue( Form( "%02d.Doublet", i ), false ) )p->SetDoublet();
+			if( m_config->GetValue( Form( "%02d.Doublet", i ), false ) )p->SetDoublet();
 
 			// Fix widths of individual states
-			p->SetFixedWidth( config->GetValue( Form( "%02d.Width_fixed", i ), false ) );
+			p->SetFixedWidth( m_config->GetValue( Form( "%02d.Width_fixed", i ), false ) );
 			if ( !p->HasFixedWidth() && p->IsBound() && !p->IsDoublet() ){
 				// Bound non-doublet and decided to do width things -- print warnings
 				// Warn user of setting bound fixed width options
@@ -184,27 +405,27 @@ void InputFileProcessor::ProcessOptions(){
 				bool print_warning = false;
 
 				// Width
-				if ( config->GetValue( Form( "%02d.Width", i ), -1e5 ) != -1e5 ){
+				if ( m_config->GetValue( Form( "%02d.Width", i ), -1e5 ) != -1e5 ){
 					print_warning = true;
 					warning.Append( Form( "%02d.Width", i ) );
 				}
 
 				// Width LB
-				if ( config->GetValue( Form( "%02d.Width_LB", i ), -1e5 ) != -1e5 ){
+				if ( m_config->GetValue( Form( "%02d.Width_LB", i ), -1e5 ) != -1e5 ){
 					if ( print_warning ){ warning.Append(", "); suffix.Append("/"); }
 					else{ print_warning = true; }
 					warning.Append( Form( "%02d.Width_LB", i ) ); suffix.Append("_LB");
 				}
 
 				// Width UB
-				if ( config->GetValue( Form( "%02d.Width_UB", i ), -1e5 ) != -1e5 ){
+				if ( m_config->GetValue( Form( "%02d.Width_UB", i ), -1e5 ) != -1e5 ){
 					if ( print_warning ){ warning.Append(", "); suffix.Append("/"); }
 					else{ print_warning = true; }
 					warning.Append( Form( "%02d.Width_UB", i ) ); suffix.Append("_UB");
 				}
 
 				// Width fixed
-				if ( config->GetValue( Form( "%02d.Width_fixed", i ), -1e5 ) != -1e5 ){
+				if ( m_config->GetValue( Form( "%02d.Width_fixed", i ), -1e5 ) != -1e5 ){
 					if ( print_warning ){ warning.Append(", "); suffix.Append("/"); }
 					else{ print_warning = true; }
 					warning.Append( Form( "%02d.Width_fixed", i ) ); suffix.Append("_fixed");
@@ -221,92 +442,61 @@ void InputFileProcessor::ProcessOptions(){
 					log->Warning( "Fixing width of a bound state. Are you sure? Trying anyway...");
 				}
 
-				p->SetWidth( config->GetValue( Form( "%02d.Width", i ), -1.0 ) );
-				p->SetWidthLB( config->GetValue( Form( "%02d.Width_LB", i ), -1.0 ) );
-				p->SetWidthUB( config->GetValue( Form( "%02d.Width_UB", i ), -1.0 ) );
+				p->SetWidth( m_config->GetValue( Form( "%02d.Width", i ), -1.0 ) );
+				p->SetWidthLB( m_config->GetValue( Form( "%02d.Width_LB", i ), -1.0 ) );
+				p->SetWidthUB( m_config->GetValue( Form( "%02d.Width_UB", i ), -1.0 ) );
 			} 
 			
-			m_spec->AddPeak(p);
+			spec->AddPeak(p);
+		}
+
+		// Replace the guesses with the previous results
+		if ( m_fit_reader != nullptr ){
+			m_fit_reader->WarmStartSpectrum( spec, m_hist_label_list.at(n), m_config->GetValue( "WarmStartBoundScale", 5.0 ) );
 		}
 	}
 	else{
 		log->Error("Unable to read input file correctly");
 	}
-
-	// SPECTRUM FITTER OPTIONS
-	if ( m_sf == nullptr ){
-		log->Warning("SpectrumFitter not initialised!");
-	}
-
-	// SPECTRUM DRAWER OPTIONS
-	if ( m_sd != nullptr ){
-		m_sd->SetPrintPS( config->GetValue( "PrintPS", false ) );
-		m_sd->SetPrintEPS( config->GetValue( "PrintEPS", false ) );
-		m_sd->SetPrintPDF( config->GetValue( "PrintPDF", false ) );
-		m_sd->SetPrintSVG( config->GetValue( "PrintSVG", false ) );
-		m_sd->SetPrintTEX( config->GetValue( "PrintTEX", false ) );
-		m_sd->SetPrintGIF( config->GetValue( "PrintGIF", false ) );
-		m_sd->SetPrintXPM( config->GetValue( "PrintXPM", false ) );
-		m_sd->SetPrintPNG( config->GetValue( "PrintPNG", false ) );
-		m_sd->SetPrintJPG( config->GetValue( "PrintJPG", false ) );
-		m_sd->SetPrintTIFF( config->GetValue( "PrintTIFF", false ) );
-		m_sd->SetPrintCXX( config->GetValue( "PrintCXX", false ) );
-		m_sd->SetPrintXML( config->GetValue( "PrintXML", false ) );
-		m_sd->SetPrintJSON( config->GetValue( "PrintJSON", false ) );
-		m_sd->SetPrintROOT( config->GetValue( "PrintROOT", false ) );
-
-		m_sd->SetPrintFileName( config->GetValue( "PrintFileName", "myspectrum" ) );
-		m_sd->SetCanvasWidth( config->GetValue( "CanvasWidth", 1200 ) );
-		m_sd->SetCanvasHeight( config->GetValue( "CanvasHeight", 900 ) );
-		m_sd->SetCanvasTitle( config->GetValue( "CanvasTitle", "TITLE" ) );
-		m_sd->SetXAxisTitle( config->GetValue( "XAxisTitle", "X" ) );
-		m_sd->SetYAxisTitle( config->GetValue( "YAxisTitle", "Y" ) );
-		m_sd->SetXAxisLB( config->GetValue( "XAxisLB", 0.0 ) );
-		m_sd->SetXAxisUB( config->GetValue( "XAxisUB", 0.0 ) );
-		m_sd->SetXAxisLBDefined( config->Defined( "XAxisLB" ) );
-		m_sd->SetXAxisUBDefined( config->Defined( "XAxisUB" ) );
-		m_sd->SetInteractiveMode( config->GetValue( "InteractiveMode", false ) );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void InputFileProcessor::ProcessDrawerOptions( const unsigned int n, SFSpectrumDrawer *sd ){
+	if ( sd != nullptr ){
+		sd->SetPrintPS( m_config->GetValue( "PrintPS", false ) );
+		sd->SetPrintEPS( m_config->GetValue( "PrintEPS", false ) );
+		sd->SetPrintPDF( m_config->GetValue( "PrintPDF", false ) );
+		sd->SetPrintSVG( m_config->GetValue( "PrintSVG", false ) );
+		sd->SetPrintTEX( m_config->GetValue( "PrintTEX", false ) );
+		sd->SetPrintGIF( m_config->GetValue( "PrintGIF", false ) );
+		sd->SetPrintXPM( m_config->GetValue( "PrintXPM", false ) );
+		sd->SetPrintPNG( m_config->GetValue( "PrintPNG", false ) );
+		sd->SetPrintJPG( m_config->GetValue( "PrintJPG", false ) );
+		sd->SetPrintTIFF( m_config->GetValue( "PrintTIFF", false ) );
+		sd->SetPrintCXX( m_config->GetValue( "PrintCXX", false ) );
+		sd->SetPrintXML( m_config->GetValue( "PrintXML", false ) );
+		sd->SetPrintJSON( m_config->GetValue( "PrintJSON", false ) );
+		sd->SetPrintROOT( m_config->GetValue( "PrintROOT", false ) );
+
+		// Give each histogram its own output files when fitting more than one
+		TString print_file_name = m_config->GetValue( "PrintFileName", "myspectrum" );
+		if ( this->GetNumberOfHistograms() > 1 ){
+			print_file_name.Append( "_" + m_hist_tag_list.at(n) );
+		}
+		sd->SetPrintFileName( print_file_name );
+		sd->SetCanvasWidth( m_config->GetValue( "CanvasWidth", 1200 ) );
+		sd->SetCanvasHeight( m_config->GetValue( "CanvasHeight", 900 ) );
+		sd->SetCanvasTitle( m_config->GetValue( "CanvasTitle", "TITLE" ) );
+		sd->SetXAxisTitle( m_config->GetValue( "XAxisTitle", "X" ) );
+		sd->SetYAxisTitle( m_config->GetValue( "YAxisTitle", "Y" ) );
+		sd->SetXAxisLB( m_config->GetValue( "XAxisLB", 0.0 ) );
+		sd->SetXAxisUB( m_config->GetValue( "XAxisUB", 0.0 ) );
+		sd->SetXAxisLBDefined( m_config->Defined( "XAxisLB" ) );
+		sd->SetXAxisUBDefined( m_config->Defined( "XAxisUB" ) );
+		sd->SetInteractiveMode( m_config->GetValue( "InteractiveMode", false ) );
 	}
 	else{
 		log->Warning("SpectrumDrawer not initialised!");
 	}
-
-	f->Close();
-	delete f;
-	delete config;
 	return;
 }
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
@@ -0,0 +1,142 @@
+#include "IntegralEngine.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFIntegralEngine::SFIntegralEngine(){
+	m_cumulative.resize(0);
+	log->Construction("SFIntegralEngine::SFIntegralEngine -- SFIntegralEngine object constructed");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFIntegralEngine::~SFIntegralEngine(){
+	m_cumulative.clear();
+	log->Construction("SFIntegralEngine::~SFIntegralEngine -- SFIntegralEngine object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+// Everything the background of an integral depends on, so that integrals with
+// the same key can share the sums
+std::vector<double> SFIntegralEngine::GetBackgroundKey( const SFSpectrumIntegral *integral ){
+	const unsigned int order = integral->GetBGPolyOrder();
+	std::vector<double> key;
+	key.reserve( 2 + ( order + 1 )*( order + 4 )/2 );
+	key.push_back( integral->IsBackgroundFromCoordinates() );
+	key.push_back( order );
+	for ( unsigned int i = 0; i <= order; ++i ){
+		key.push_back( integral->GetBGPoly(i) );
+		key.push_back( integral->GetBGPolyErr(i) );
+		for ( unsigned int j = 0; j < i; ++j ){
+			key.push_back( integral->GetBGCovMatrix(i,j) );
+		}
+	}
+	return key;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFIntegralEngine::CalculateIntegrals( const SFSpectrum *spec, const std::vector<SFSpectrumIntegral*> &integrals ){
+	// Same backgrounds together, then by LB
+	std::vector<std::pair<std::vector<double>,SFSpectrumIntegral*>> sorted( integrals.size() );
+	for ( unsigned int i = 0; i < integrals.size(); ++i ){
+		sorted[i] = std::make_pair( GetBackgroundKey( integrals[i] ), integrals[i] );
+	}
+	std::sort( sorted.begin(), sorted.end(), []( const std::pair<std::vector<double>,SFSpectrumIntegral*> &a, const std::pair<std::vector<double>,SFSpectrumIntegral*> &b ){
+		if ( a.first != b.first )return ( a.first < b.first );
+		return ( a.second->GetIntegralLB() < b.second->GetIntegralLB() );
+	} );
+
+	// Split where the background changes or there is a gap between the windows
+	std::vector<SFSpectrumIntegral*> group;
+	double group_ub = 0.0;
+	unsigned int number_of_groups = 0;
+	for ( unsigned int i = 0; i <= sorted.size(); ++i ){
+		if ( i < sorted.size() && group.size() > 0 && sorted[i].second->GetIntegralLB() < group_ub && sorted[i].first == sorted[i-1].first ){
+			group.push_back( sorted[i].second );
+			group_ub = TMath::Max( group_ub, sorted[i].second->GetIntegralUB() );
+			continue;
+		}
+
+		if ( group.size() == 1 )group.front()->CalculateIntegral();
+		else if ( group.size() > 1 )this->CalculateGroup( spec, group );
+		if ( group.size() > 0 )number_of_groups++;
+
+		group.resize(0);
+		if ( i < sorted.size() ){
+			group.push_back( sorted[i].second );
+			group_ub = sorted[i].second->GetIntegralUB();
+		}
+	}
+
+	log->Debug( Form( "SFIntegralEngine::CalculateIntegrals -- Calculated %lu integrals in %u groups", integrals.size(), number_of_groups ) );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFIntegralEngine::CalculateGroup( const SFSpectrum *spec, const std::vector<SFSpectrumIntegral*> &group ){
+	const SFSpectrumIntegral *first = group.front();
+	const unsigned int order = first->GetBGPolyOrder();
+	std::vector<double> c( order + 1 );
+	for ( unsigned int k = 0; k <= order; ++k ){
+		c[k] = first->GetBGPoly(k);
+	}
+
+	double group_ub = first->GetIntegralUB();
+	for ( unsigned int i = 1; i < group.size(); ++i ){
+		group_ub = TMath::Max( group_ub, group[i]->GetIntegralUB() );
+	}
+
+	const int n = spec->GetNumberOfBins();
+	const int first_bin = TMath::Max( spec->FindBin( first->GetIntegralLB() ), 1 );
+	const int last_bin = TMath::Min( spec->FindBin( group_ub ), n );
+	m_cumulative.assign( order + 3, std::vector<double>( TMath::Max( last_bin - first_bin + 1, 0 ) + 1, 0.0 ) );
+
+	std::vector<double> gradient( order + 1 );
+	SFPolynomialDispatch( order, [&]( auto poly ){
+		// Whole bins, in one sweep
+		double y1 = ( first_bin <= last_bin ? poly.Value( c.data(), spec->GetBinLowEdge( first_bin ), order ) : 0.0 );
+		for ( int i = first_bin; i <= last_bin; ++i ){
+			const int j = i - first_bin + 1;
+			double y2 = poly.Value( c.data(), spec->GetBinUpEdge(i), order );
+			std::fill( gradient.begin(), gradient.end(), 0.0 );
+			double bg = first->GetBackgroundInBin( poly, spec->GetBinLowEdge(i), spec->GetBinUpEdge(i), y1, y2, spec->GetBinContent(i), spec->GetBinWidth(i), gradient.data() );
+			m_cumulative[0][j] = m_cumulative[0][j-1] + bg;
+			m_cumulative[1][j] = m_cumulative[1][j-1] + spec->GetBinCentre(i)*bg;
+			for ( unsigned int k = 0; k <= order; ++k ){
+				m_cumulative[k+2][j] = m_cumulative[k+2][j-1] + gradient[k];
+			}
+			y1 = y2;
+		}
+
+		// Each window is its whole bins, from the sums, and the parts of its end bins
+		for ( SFSpectrumIntegral *integral : group ){
+			const double lb = integral->GetIntegralLB();
+			const double ub = integral->GetIntegralUB();
+			double bg_integral = 0.0;
+			double bg_sum_x = 0.0;
+			std::fill( gradient.begin(), gradient.end(), 0.0 );
+
+			auto add_part_bin = [&]( const int i ){
+				double x1 = TMath::Max( spec->GetBinLowEdge(i), lb );
+				double x2 = TMath::Min( spec->GetBinUpEdge(i), ub );
+				double bg = integral->GetBackgroundInBin( poly, x1, x2, poly.Value( c.data(), x1, order ), poly.Value( c.data(), x2, order ), spec->GetBinContent(i), spec->GetBinWidth(i), gradient.data() );
+				bg_integral += bg;
+				bg_sum_x += spec->GetBinCentre(i)*bg;
+			};
+
+			const int lo = TMath::Max( spec->FindBin( lb ), 1 );
+			const int hi = TMath::Min( spec->FindBin( ub ), n );
+			if ( lo == hi )add_part_bin( lo );
+			else if ( lo < hi ){
+				add_part_bin( lo );
+				add_part_bin( hi );
+
+				// Bins lo+1 to hi-1
+				const int a = lo + 1 - first_bin;
+				const int b = hi - first_bin;
+				bg_integral += m_cumulative[0][b] - m_cumulative[0][a];
+				bg_sum_x += m_cumulative[1][b] - m_cumulative[1][a];
+				for ( unsigned int k = 0; k <= order; ++k ){
+					gradient[k] += m_cumulative[k+2][b] - m_cumulative[k+2][a];
+				}
+			}
+
+			integral->SetIntegralFromSums( spec->GetCountsInRange( lb, ub ), spec->GetCountsInRange( lb, ub, 1 ), spec->GetCountsInRange( lb, ub, 2 ), bg_integral, bg_sum_x, gradient );
+		}
+	} );
+
+	return;
+}
@@ -0,0 +1,82 @@
+#include "LikelihoodFunction.hh"
+
+#include <limits>
+
+///////////////////////////////////////////////////////////////////////////////
+SFLikelihoodFunction::SFLikelihoodFunction( const SFFitFunction &model, const std::vector<double> &x, const std::vector<double> &y ) : m_kernel( model, x ), m_y( y ){
+	if ( x.size() != y.size() ){
+		log->Error( Form( "SFLikelihoodFunction::SFLikelihoodFunction -- Different number of bin centres (%lu) and bin contents (%lu)", x.size(), y.size() ) );
+	}
+	m_mu.resize( m_y.size() );
+	m_w.resize( m_y.size() );
+	m_number_of_evaluations = 0;
+	m_number_of_gradient_evaluations = 0;
+
+	// Terms that only depend on the data are summed once here
+	m_saturated = 0.0;
+	m_log_factorial = 0.0;
+	for ( unsigned int i = 0; i < m_y.size(); ++i ){
+		if ( m_y[i] > 0.0 ){
+			m_saturated += m_y[i]*TMath::Log( m_y[i] ) - m_y[i];
+		}
+		m_log_factorial += TMath::LnGamma( m_y[i] + 1.0 );
+	}
+	log->Construction("SFLikelihoodFunction::SFLikelihoodFunction -- SFLikelihoodFunction object constructed");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFLikelihoodFunction::~SFLikelihoodFunction(){
+	m_y.clear();
+	m_mu.clear();
+	m_w.clear();
+	log->Construction("SFLikelihoodFunction::~SFLikelihoodFunction -- SFLikelihoodFunction object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+// Evaluate the model in all bins in one go, then sum the likelihood. The
+// gradient weights d(chi2)/d(mu) = 2*( 1 - y/mu ) are stored if requested.
+// Only mu - y*ln(mu) depends on the parameters, and y*ln(mu) vanishes for
+// empty bins because mu is kept above zero.
+double SFLikelihoodFunction::CalculateModelAndWeights( const double *p, const bool calculate_weights ) const {
+	const double tiny = std::numeric_limits<double>::min();
+	m_kernel.Evaluate( p, m_mu.data() );
+
+	double sum = 0.0;
+	for ( unsigned int i = 0; i < m_y.size(); ++i ){
+		double mu = TMath::Max( m_mu[i], tiny );
+		sum += mu - m_y[i]*TMath::Log( mu );
+		if ( calculate_weights ){
+			m_w[i] = 2.0*( 1.0 - m_y[i]/mu );
+		}
+	}
+	return 2.0*( sum + m_saturated );
+}
+///////////////////////////////////////////////////////////////////////////////
+// -ln L = sum( mu - y*ln(mu) + ln(y!) ) = chi2/2 - sum( y*ln(y) - y ) + sum( ln(y!) )
+double SFLikelihoodFunction::GetNegativeLogLikelihood( const double *p ) const {
+	return 0.5*this->CalculateModelAndWeights( p, false ) - m_saturated + m_log_factorial;
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFLikelihoodFunction::DoEval( const double *p ) const {
+	m_number_of_evaluations++;
+	return this->CalculateModelAndWeights( p, false );
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFLikelihoodFunction::Gradient( const double *p, double *grad ) const {
+	m_number_of_gradient_evaluations++;
+	this->CalculateModelAndWeights( p, true );
+	m_kernel.WeightedGradient( p, m_w.data(), grad );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFLikelihoodFunction::FdF( const double *p, double &f, double *grad ) const {
+	m_number_of_evaluations++;
+	m_number_of_gradient_evaluations++;
+	f = this->CalculateModelAndWeights( p, true );
+	m_kernel.WeightedGradient( p, m_w.data(), grad );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFLikelihoodFunction::DoDerivative( const double *p, unsigned int ipar ) const {
+	std::vector<double> grad( this->NDim() );
+	this->Gradient( p, grad.data() );
+	return grad.at(ipar);
+}
@@ -44,6 +44,8 @@ TString MessageLogger::MakeFormattedString( TString s, const TerminalFormat f =
 ///////////////////////////////////////////////////////////////////////////////
 void MessageLogger::GeneralMessage( const TString message, const Level level ) const{
 	if ( this->GetPrintConsoleLevel() <= level ){ 
+		std::lock_guard<std::mutex> lock( m_mutex );
+
 		// Assign general values
 		TString s_level = "";
 
@@ -0,0 +1,121 @@
+#include "PeakFinder.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFPeakFinder::SFPeakFinder(){
+	m_candidates.resize(0);
+	log->Construction("SFPeakFinder::SFPeakFinder -- SFPeakFinder object constructed");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFPeakFinder::~SFPeakFinder(){
+	m_candidates.clear();
+	log->Construction("SFPeakFinder::~SFPeakFinder -- SFPeakFinder object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFPeakFinder::Search( const std::vector<double> &x, const std::vector<double> &y, const double width_guess, const double threshold ){
+	m_candidates.clear();
+	const int n = x.size();
+	if ( n < 3 )return;
+
+	// Kernel in units of bins, out to 3 sigma, with zero sum so a flat background cancels
+	const double dx = ( x.back() - x.front() )/( n - 1 );
+	const double s = TMath::Max( width_guess/dx, 1.0 );
+	const int half_length = TMath::CeilNint( 3.0*s );
+	if ( n <= 2*half_length + 2 ){
+		log->Warning( Form( "SFPeakFinder::Search -- Only %d bins, which is too few to search for peaks %.1f bins wide", n, s ) );
+		return;
+	}
+
+	std::vector<double> kernel( 2*half_length + 1 );
+	double kernel_sum = 0.0;
+	for ( int k = -half_length; k <= half_length; ++k ){
+		double u = k*k/( s*s );
+		kernel.at( k + half_length ) = ( 1.0 - u )*TMath::Exp( -0.5*u );
+		kernel_sum += kernel.at( k + half_length );
+	}
+	for ( unsigned int k = 0; k < kernel.size(); ++k ){
+		kernel.at(k) -= kernel_sum/kernel.size();
+	}
+
+	// Smoothed second derivative and its significance (empty bins count as one)
+	std::vector<double> smoothed( n, 0.0 ), significance( n, 0.0 );
+	for ( int i = half_length; i < n - half_length; ++i ){
+		double sum = 0.0, variance = 0.0;
+		for ( int k = -half_length; k <= half_length; ++k ){
+			double w = kernel[ k + half_length ];
+			sum += w*y[ i + k ];
+			variance += w*w*TMath::Max( y[ i + k ], 1.0 );
+		}
+		smoothed[i] = sum;
+		significance[i] = sum/TMath::Sqrt( variance );
+	}
+
+	// Local maxima above the threshold
+	for ( int i = half_length + 1; i < n - half_length - 1; ++i ){
+		if ( significance[i] < threshold )continue;
+		if ( smoothed[i] < smoothed[i-1] || smoothed[i] <= smoothed[i+1] )continue;
+
+		// Parabola through the maximum for the mean
+		double curvature = smoothed[i-1] - 2.0*smoothed[i] + smoothed[i+1];
+		double shift = ( curvature < 0.0 ? 0.5*( smoothed[i-1] - smoothed[i+1] )/curvature : 0.0 );
+		shift = TMath::Max( TMath::Min( shift, 0.5 ), -0.5 );
+
+		// Height above the background either side of the peak (averaged over 3 bins)
+		double background = 0.0;
+		for ( int k = -1; k <= 1; ++k ){
+			background += y[ TMath::Max( i - half_length + k, 0 ) ] + y[ TMath::Min( i + half_length + k, n - 1 ) ];
+		}
+		background /= 6.0;
+		double amplitude = y[i] - background;
+		if ( amplitude <= 0.0 )continue;
+
+		Candidate c;
+		c.mean = x[i] + shift*dx;
+		c.amplitude = amplitude;
+		c.significance = significance[i];
+		c.width = EstimateWidth( y, i, background, amplitude, half_length );
+		c.width = ( c.width > 0.0 ? c.width*dx : width_guess );
+		m_candidates.push_back(c);
+	}
+
+	log->Debug( Form( "SFPeakFinder::Search -- Found %lu peaks above %.1f sigma", m_candidates.size(), threshold ) );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Index of the candidate closest to x, or -1 if none are within max_distance
+int SFPeakFinder::FindNearestCandidate( const double x, const double max_distance ) const {
+	int nearest = -1;
+	double distance = max_distance;
+	for ( unsigned int i = 0; i < m_candidates.size(); ++i ){
+		if ( TMath::Abs( m_candidates.at(i).mean - x ) <= distance ){
+			distance = TMath::Abs( m_candidates.at(i).mean - x );
+			nearest = i;
+		}
+	}
+	return nearest;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Sigma (in bins) from the full width at half maximum, or -1 if either side
+// does not fall to half height within max_distance bins
+double SFPeakFinder::EstimateWidth( const std::vector<double> &y, const int peak_bin, const double background, const double amplitude, const int max_distance ) const {
+	const int n = y.size();
+	const double half = background + 0.5*amplitude;
+	double edge[2] = { -1.0, -1.0 };
+
+	for ( int side = 0; side < 2; ++side ){
+		int step = ( side == 0 ? -1 : 1 );
+		for ( int k = 1; k <= max_distance; ++k ){
+			int j = peak_bin + step*k;
+			if ( j < 0 || j >= n )break;
+			if ( y[j] < half ){
+				// Interpolate between this bin and the previous one
+				double previous = y[ j - step ];
+				double fraction = ( previous > y[j] ? ( previous - half )/( previous - y[j] ) : 1.0 );
+				edge[side] = k - 1 + fraction;
+				break;
+			}
+		}
+	}
+
+	if ( edge[0] < 0.0 || edge[1] < 0.0 )return -1.0;
+	return ( edge[0] + edge[1] )/( 2.0*TMath::Sqrt( 2.0*TMath::Log( 2.0 ) ) );
+}
@@ -0,0 +1,156 @@
+#include "Profiler.hh"
+
+SFProfiler* SFProfiler::m_instance_ptr = nullptr;
+
+// Timers started on this thread: record number and start times
+struct SFProfilerFrame{
+	int record;
+	double wall;
+	double cpu;
+};
+static thread_local std::vector<SFProfilerFrame> g_profiler_stack;
+
+///////////////////////////////////////////////////////////////////////////////
+SFProfiler::Timer::Timer( const TString &name ){
+	SFProfiler *p = SFProfiler::GetInstance();
+	m_running = p->IsEnabled();
+	if ( m_running )p->Start( name );
+}
+///////////////////////////////////////////////////////////////////////////////
+SFProfiler::Timer::Timer( const TString &name, const int parent ){
+	SFProfiler *p = SFProfiler::GetInstance();
+	m_running = p->IsEnabled();
+	if ( m_running )p->Start( name, parent );
+}
+///////////////////////////////////////////////////////////////////////////////
+SFProfiler::Timer::~Timer(){
+	if ( m_running )SFProfiler::GetInstance()->Stop();
+}
+///////////////////////////////////////////////////////////////////////////////
+SFProfiler::SFProfiler(){
+	m_enabled = false;
+	m_start_time = std::chrono::steady_clock::now();
+	m_records.resize(0);
+	log->Construction("SFProfiler::SFProfiler -- SFProfiler object created");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFProfiler::~SFProfiler(){
+	m_records.clear();
+	m_record_index.clear();
+	if ( m_instance_ptr == this )m_instance_ptr = nullptr;
+	log->Construction("SFProfiler::~SFProfiler -- SFProfiler object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFProfiler::GetWallTime() const {
+	return std::chrono::duration<double>( std::chrono::steady_clock::now() - m_start_time ).count();
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFProfiler::GetThreadCPUTime() const {
+	timespec t;
+	clock_gettime( CLOCK_THREAD_CPUTIME_ID, &t );
+	return t.tv_sec + 1e-9*t.tv_nsec;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFProfiler::Start( const TString &name ){
+	this->Start( name, this->GetCurrentTimer() );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFProfiler::Start( const TString &name, const int parent ){
+	if ( !m_enabled )return;
+
+	int n;
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		std::pair<int,TString> key( parent, name );
+		std::map< std::pair<int,TString>, int >::const_iterator it = m_record_index.find( key );
+		if ( it == m_record_index.end() ){
+			n = m_records.size();
+			m_records.push_back( { name, parent, 0, 0.0, 0.0 } );
+			m_record_index[key] = n;
+		}
+		else{
+			n = it->second;
+		}
+	}
+
+	g_profiler_stack.push_back( { n, GetWallTime(), GetThreadCPUTime() } );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFProfiler::Stop(){
+	if ( !m_enabled )return;
+	if ( g_profiler_stack.size() == 0 ){
+		log->Warning("SFProfiler::Stop -- No timer is running on this thread");
+		return;
+	}
+	SFProfilerFrame frame = g_profiler_stack.back();
+	g_profiler_stack.pop_back();
+	double wall = GetWallTime() - frame.wall;
+	double cpu = GetThreadCPUTime() - frame.cpu;
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	Record &r = m_records.at( frame.record );
+	r.calls++;
+	r.wall += wall;
+	r.cpu += cpu;
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+int SFProfiler::GetCurrentTimer() const {
+	return ( g_profiler_stack.size() > 0 ? g_profiler_stack.back().record : -1 );
+}
+///////////////////////////////////////////////////////////////////////////////
+// The timers as a tree, in the order they were first started. Timers running on
+// several threads at once (e.g. the fits) can add up to more than their parent.
+// The process CPU time includes everything before main (e.g. loading ROOT).
+void SFProfiler::WriteJSON( const TString &file_name ) const {
+	std::ofstream f( file_name.Data() );
+	if ( !f.is_open() ){
+		log->Warning( Form( "SFProfiler::WriteJSON -- Could not open %s", file_name.Data() ) );
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	f << "{" << std::endl;
+	f << "\t\"wall_s\": " << GetWallTime() << "," << std::endl;
+	f << "\t\"process_cpu_s\": " << (double)std::clock()/CLOCKS_PER_SEC << "," << std::endl;
+	f << "\t\"timers\": [";
+	bool first = true;
+	for ( unsigned int i = 0; i < m_records.size(); ++i ){
+		if ( m_records.at(i).parent != -1 )continue;
+		f << ( first ? "" : "," ) << std::endl;
+		WriteRecord( f, i, "\t\t" );
+		first = false;
+	}
+	f << std::endl << "\t]" << std::endl << "}" << std::endl;
+	f.close();
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFProfiler::WriteRecord( std::ofstream &f, const int n, const TString &indent ) const {
+	const Record &r = m_records.at(n);
+	f << indent << "{ \"name\": \"" << EscapeJSON( r.name ) << "\", \"calls\": " << r.calls << ", \"wall_s\": " << r.wall << ", \"cpu_s\": " << r.cpu;
+
+	bool first = true;
+	for ( unsigned int i = n + 1; i < m_records.size(); ++i ){
+		if ( m_records.at(i).parent != n )continue;
+		f << ( first ? ", \"children\": [" : "," ) << std::endl;
+		WriteRecord( f, i, indent + "\t" );
+		first = false;
+	}
+	if ( !first )f << std::endl << indent << "]";
+	f << " }";
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+TString SFProfiler::EscapeJSON( const TString &s ) const {
+	TString escaped = "";
+	for ( int i = 0; i < s.Length(); ++i ){
+		char c = s[i];
+		if ( c == '"' || c == '\\' )escaped.Append('\\');
+		if ( (unsigned char)c < 0x20 )escaped.Append(' ');
+		else escaped.Append(c);
+	}
+	return escaped;
+}
@@ -0,0 +1,300 @@
+#include "ProjectedLikelihood.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFProjectedLikelihood::SFProjectedLikelihood( const SFLikelihoodFunction &likelihood, const SFFitFunction &model, const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &p, const std::vector<double> &lb, const std::vector<double> &ub ) : m_likelihood( &likelihood ), m_model( model ), m_x( x ), m_y( y ), m_p( p ){
+	const unsigned int n = m_x.size();
+	const unsigned int npeaks = m_model.GetNumberOfPeaks();
+	const unsigned int nbg = m_model.GetBGPolyOrder() + 1;
+
+	// Split the parameters
+	std::vector<bool> is_linear( m_model.NPar(), false );
+	for ( unsigned int k = 0; k < npeaks; ++k ){
+		m_linear_index.push_back( m_model.GetAmplitudeIndex(k) );
+	}
+	for ( unsigned int j = 0; j < nbg; ++j ){
+		m_linear_index.push_back( m_model.GetBGParameterIndex() + j );
+	}
+	for ( unsigned int m = 0; m < m_linear_index.size(); ++m ){
+		is_linear.at( m_linear_index.at(m) ) = true;
+		m_lb.push_back( lb.at( m_linear_index.at(m) ) );
+		m_ub.push_back( ub.at( m_linear_index.at(m) ) );
+	}
+	for ( unsigned int j = 0; j < m_model.NPar(); ++j ){
+		if ( !is_linear.at(j) )m_nonlinear_index.push_back(j);
+	}
+
+	// The background terms do not change, so they are filled in once
+	m_basis.assign( m_linear_index.size()*n, 0.0 );
+	m_first_bin.assign( m_linear_index.size(), 0 );
+	m_last_bin.assign( m_linear_index.size(), n );
+	for ( unsigned int j = 0; j < nbg; ++j ){
+		double *row = &m_basis[ ( npeaks + j )*n ];
+		if ( j == 0 ){
+			std::fill( row, row + n, 1.0 );
+			continue;
+		}
+
+		// x^j from the row of x^(j-1)
+		const double *previous_row = row - n;
+		for ( unsigned int i = 0; i < n; ++i ){
+			row[i] = previous_row[i]*m_x[i];
+		}
+	}
+
+	log->Construction( Form( "SFProjectedLikelihood::SFProjectedLikelihood -- SFProjectedLikelihood object constructed (%lu nonlinear and %lu linear parameters)", m_nonlinear_index.size(), m_linear_index.size() ) );
+}
+///////////////////////////////////////////////////////////////////////////////
+SFProjectedLikelihood::~SFProjectedLikelihood(){
+	log->Construction("SFProjectedLikelihood::~SFProjectedLikelihood -- SFProjectedLikelihood object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFProjectedLikelihood::GetParameters( const double *q, double *p ) const {
+	SolveLinearParameters(q);
+	std::copy( m_p.begin(), m_p.end(), p );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFProjectedLikelihood::DoEval( const double *q ) const {
+	SolveLinearParameters(q);
+	return (*m_likelihood)( m_p.data() );
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFProjectedLikelihood::Gradient( const double *q, double *grad ) const {
+	double f;
+	this->FdF( q, f, grad );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFProjectedLikelihood::FdF( const double *q, double &f, double *grad ) const {
+	SolveLinearParameters(q);
+	std::vector<double> full_grad( m_p.size() );
+	m_likelihood->FdF( m_p.data(), f, full_grad.data() );
+	for ( unsigned int i = 0; i < m_nonlinear_index.size(); ++i ){
+		grad[i] = full_grad[ m_nonlinear_index[i] ];
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFProjectedLikelihood::DoDerivative( const double *q, unsigned int ipar ) const {
+	std::vector<double> grad( this->NDim() );
+	this->Gradient( q, grad.data() );
+	return grad.at(ipar);
+}
+///////////////////////////////////////////////////////////////////////////////
+// Unit-amplitude Gaussians for the current means and widths, limited to the
+// range of bins used by SFFitKernel
+void SFProjectedLikelihood::CalculatePeakBasis() const {
+	const unsigned int n = m_x.size();
+	const double peak_range = m_likelihood->GetPeakRange();
+
+	for ( unsigned int k = 0; k < m_model.GetNumberOfPeaks(); ++k ){
+		double mean = m_p[ m_model.GetMeanIndex(k) ];
+		double inv_sigma = 1.0/m_model.GetSigma( k, m_p.data() );
+		double *row = &m_basis[ k*n ];
+
+		unsigned int first = 0, last = n;
+		double half_width = peak_range/TMath::Abs( inv_sigma );
+		if ( peak_range > 0.0 && n > 1 && half_width < m_x.back() - m_x.front() ){
+			first = std::lower_bound( m_x.begin(), m_x.end(), mean - half_width ) - m_x.begin();
+			last = std::upper_bound( m_x.begin() + first, m_x.end(), mean + half_width ) - m_x.begin();
+		}
+
+		std::fill( row + m_first_bin[k], row + m_last_bin[k], 0.0 );
+		for ( unsigned int i = first; i < last; ++i ){
+			double t = ( m_x[i] - mean )*inv_sigma;
+			row[i] = TMath::Exp( -0.5*t*t );
+		}
+		m_first_bin[k] = first;
+		m_last_bin[k] = last;
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// sum( mu - y*ln(mu) ), the part of -ln(L) that depends on the parameters, as in SFLikelihoodFunction
+double SFProjectedLikelihood::CalculateObjective( const std::vector<double> &c, std::vector<double> &mu ) const {
+	const unsigned int n = m_x.size();
+	const double tiny = std::numeric_limits<double>::min();
+
+	std::fill( mu.begin(), mu.end(), 0.0 );
+	for ( unsigned int m = 0; m < c.size(); ++m ){
+		const double *row = &m_basis[ m*n ];
+		for ( unsigned int i = m_first_bin[m]; i < m_last_bin[m]; ++i ){
+			mu[i] += c[m]*row[i];
+		}
+	}
+
+	double sum = 0.0;
+	for ( unsigned int i = 0; i < n; ++i ){
+		mu[i] = TMath::Max( mu[i], tiny );
+		sum += mu[i] - m_y[i]*TMath::Log( mu[i] );
+	}
+	return sum;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Projected Newton iterations: parameters held at a limit by the gradient are
+// left out of the Newton step, and the step is cut back until the likelihood
+// decreases. The Hessian of the Poisson likelihood is sum( y/mu^2 * B_m*B_n ).
+void SFProjectedLikelihood::SolveLinearParameters( const double *q ) const {
+	const unsigned int nq = m_nonlinear_index.size();
+	if ( m_last_q.size() == nq && ( nq == 0 || std::memcmp( m_last_q.data(), q, nq*sizeof(double) ) == 0 ) )return;
+	m_last_q.assign( q, q + nq );
+
+	for ( unsigned int i = 0; i < nq; ++i ){
+		m_p[ m_nonlinear_index[i] ] = q[i];
+	}
+	CalculatePeakBasis();
+
+	const unsigned int n = m_x.size();
+	const unsigned int nc = m_linear_index.size();
+	std::vector<double> c( nc ), c_new( nc ), g( nc ), step( nc );
+	std::vector<double> mu( n ), mu_new( n ), w1( n ), w2( n );
+	std::vector<unsigned int> free_list;
+	std::vector<double> h, b;
+
+	// Start from the last solution, inside the limits
+	for ( unsigned int m = 0; m < nc; ++m ){
+		c[m] = TMath::Min( TMath::Max( m_p[ m_linear_index[m] ], m_lb[m] ), m_ub[m] );
+	}
+	double f = CalculateObjective( c, mu );
+
+	for ( unsigned int iteration = 0; iteration < 100; ++iteration ){
+		for ( unsigned int i = 0; i < n; ++i ){
+			w1[i] = 1.0 - m_y[i]/mu[i];
+			w2[i] = m_y[i]/( mu[i]*mu[i] );
+		}
+
+		// Gradient, and the parameters that are free to move
+		free_list.resize(0);
+		for ( unsigned int m = 0; m < nc; ++m ){
+			const double *row = &m_basis[ m*n ];
+			double sum = 0.0;
+			for ( unsigned int i = m_first_bin[m]; i < m_last_bin[m]; ++i ){
+				sum += row[i]*w1[i];
+			}
+			g[m] = sum;
+			step[m] = 0.0;
+			bool at_lb = ( c[m] <= m_lb[m] && g[m] > 0.0 );
+			bool at_ub = ( c[m] >= m_ub[m] && g[m] < 0.0 );
+			if ( m_lb[m] < m_ub[m] && !at_lb && !at_ub )free_list.push_back(m);
+		}
+		const unsigned int nf = free_list.size();
+		if ( nf == 0 )break;
+
+		// Hessian of the free parameters (only where the terms overlap)
+		h.assign( nf*nf, 0.0 );
+		b.assign( nf, 0.0 );
+		for ( unsigned int a = 0; a < nf; ++a ){
+			unsigned int ma = free_list[a];
+			const double *row_a = &m_basis[ ma*n ];
+			for ( unsigned int bb = 0; bb <= a; ++bb ){
+				unsigned int mb = free_list[bb];
+				const double *row_b = &m_basis[ mb*n ];
+				unsigned int first = TMath::Max( m_first_bin[ma], m_first_bin[mb] );
+				unsigned int last = TMath::Min( m_last_bin[ma], m_last_bin[mb] );
+				double sum = 0.0;
+				for ( unsigned int i = first; i < last; ++i ){
+					sum += row_a[i]*row_b[i]*w2[i];
+				}
+				h[ a*nf + bb ] = sum;
+				h[ bb*nf + a ] = sum;
+			}
+			b[a] = -g[ma];
+		}
+		if ( !SolveNewtonStep( h, b, nf ) )break;
+
+		double decrement = 0.0;
+		for ( unsigned int a = 0; a < nf; ++a ){
+			step[ free_list[a] ] = b[a];
+			decrement -= g[ free_list[a] ]*b[a];
+		}
+		if ( decrement < 1e-12 )break;
+
+		// Backtrack until the (projected) step lowers the likelihood enough
+		bool accepted = false;
+		double f_new = f;
+		for ( double t = 1.0; t > 1e-10; t *= 0.5 ){
+			double change = 0.0;
+			for ( unsigned int m = 0; m < nc; ++m ){
+				c_new[m] = TMath::Min( TMath::Max( c[m] + t*step[m], m_lb[m] ), m_ub[m] );
+				change += g[m]*( c_new[m] - c[m] );
+			}
+			f_new = CalculateObjective( c_new, mu_new );
+			if ( f_new <= f + 1e-4*change ){
+				accepted = true;
+				break;
+			}
+		}
+		if ( !accepted )break;
+
+		c.swap( c_new );
+		mu.swap( mu_new );
+		double f_change = f - f_new;
+		f = f_new;
+		if ( f_change < 1e-12*( 1.0 + TMath::Abs(f) ) )break;
+	}
+
+	for ( unsigned int m = 0; m < nc; ++m ){
+		m_p[ m_linear_index[m] ] = c[m];
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Solve h*x = b in place (b is overwritten with x) by Cholesky decomposition. The
+// matrix is scaled to unit diagonal first, as the polynomial terms differ by many
+// orders of magnitude, and a small ridge is added if it is not positive definite.
+bool SFProjectedLikelihood::SolveNewtonStep( std::vector<double> &h, std::vector<double> &b, const unsigned int n ) const {
+	std::vector<double> scale( n ), l( n*n );
+	for ( unsigned int i = 0; i < n; ++i ){
+		scale[i] = ( h[ i*n + i ] > 0.0 ? 1.0/TMath::Sqrt( h[ i*n + i ] ) : 1.0 );
+	}
+	for ( unsigned int i = 0; i < n; ++i ){
+		for ( unsigned int j = 0; j < n; ++j ){
+			h[ i*n + j ] *= scale[i]*scale[j];
+		}
+		b[i] *= scale[i];
+	}
+
+	for ( double ridge = 1e-12; ridge < 1.0; ridge *= 100.0 ){
+		bool is_positive = true;
+		for ( unsigned int j = 0; j < n && is_positive; ++j ){
+			double d = h[ j*n + j ] + ridge;
+			for ( unsigned int k = 0; k < j; ++k ){
+				d -= l[ j*n + k ]*l[ j*n + k ];
+			}
+			if ( d <= 0.0 ){
+				is_positive = false;
+				break;
+			}
+			l[ j*n + j ] = TMath::Sqrt(d);
+			for ( unsigned int i = j + 1; i < n; ++i ){
+				double s = h[ i*n + j ];
+				for ( unsigned int k = 0; k < j; ++k ){
+					s -= l[ i*n + k ]*l[ j*n + k ];
+				}
+				l[ i*n + j ] = s/l[ j*n + j ];
+			}
+		}
+		if ( !is_positive )continue;
+
+		// Forward then back substitution
+		for ( unsigned int i = 0; i < n; ++i ){
+			double s = b[i];
+			for ( unsigned int k = 0; k < i; ++k ){
+				s -= l[ i*n + k ]*b[k];
+			}
+			b[i] = s/l[ i*n + i ];
+		}
+		for ( int i = n - 1; i >= 0; --i ){
+			double s = b[i];
+			for ( unsigned int k = i + 1; k < n; ++k ){
+				s -= l[ k*n + i ]*b[k];
+			}
+			b[i] = s/l[ i*n + i ];
+		}
+		for ( unsigned int i = 0; i < n; ++i ){
+			b[i] *= scale[i];
+		}
+		return true;
+	}
+	return false;
+}
@@ -2,16 +2,20 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 SFSpectrum::SFSpectrum(){
-	m_hist = nullptr;
+	m_hist_name = "";
 	m_list_of_peaks.resize(0);
 	m_list_of_fits.resize(0);
 	m_list_of_integrals.resize(0);
+	m_bin_edges = nullptr;
+	m_cumulative_counts.assign( 3, std::vector<double>(0) );
+	m_inverse_bin_width = 0.0;
 
 	m_separation_energy = -1;
 	m_bound_width = -1;
 	m_bound_width_lb = -1;
 	m_bound_width_ub = -1;
 	m_bound_width_fixed = false;
+	m_warm_start = false;
 
 	m_guess_width = -1;
 	m_guess_width_lb = -1;
@@ -19,6 +23,12 @@ SFSpectrum::SFSpectrum(){
 	m_guess_amplitude_fraction_lb = -1;
 	m_guess_amplitude_fraction_ub = -1;
 	m_guess_mean_half_width = -1;
+	m_peak_search = false;
+	m_peak_search_threshold = 5.0;
+	m_peak_evaluation_range = 8.0;
+	m_variable_projection = false;
+	m_fit_cluster_separation = 0.0;
+	m_fit_cluster_joint_width = false;
 
 	log->Construction("SFSpectrum::SFSpectrum -- SFSpectrum object constructed");
 
@@ -26,9 +36,6 @@ SFSpectrum::SFSpectrum(){
 }
 ///////////////////////////////////////////////////////////////////////////////
 SFSpectrum::~SFSpectrum(){
-	// Remove all reference to the objects in memory
-	if ( m_hist != nullptr && !m_hist->IsDestructed() )delete m_hist;
-
 	// Free the peaks
 	for ( unsigned int i = 0; i < this->GetNumberOfPeaks(); ++i ){
 		delete this->GetPeak(i);
@@ -48,6 +55,8 @@ SFSpectrum::~SFSpectrum(){
 	m_list_of_peaks.clear();
 	m_list_of_fits.clear();
 	m_list_of_integrals.clear();
+	m_bin_edges = nullptr;
+	m_cumulative_counts.clear();
 
 	log->Construction("SFSpectrum::~SFSpectrum -- SFSpectrum object destroyed");
 }
@@ -91,6 +100,36 @@ void SFSpectrum::SetNumberOfIntegrals( const int n ){
 	return;
 }
 ///////////////////////////////////////////////////////////////////////////////
+// Put several fits in place of fit n (which is deleted). Integrals taking their
+// background from fit n move to the new fit containing their centre.
+void SFSpectrum::ReplaceFit( const unsigned int n, const std::vector<SFFit*> &fits ){
+	if ( n >= m_list_of_fits.size() || fits.size() == 0 ){
+		log->Error("SFSpectrum::ReplaceFit -- no fit to replace!");
+		return;
+	}
+	SFFit *old_fit = m_list_of_fits.at(n);
+
+	for ( unsigned int i = 0; i < this->GetNumberOfIntegrals(); ++i ){
+		SFSpectrumIntegral *integral = this->GetIntegral(i);
+		if ( integral->GetFit() != old_fit )continue;
+
+		double centre = 0.5*( integral->GetIntegralLB() + integral->GetIntegralUB() );
+		SFFit *new_fit = fits.front();
+		for ( unsigned int j = 0; j < fits.size(); ++j ){
+			if ( centre >= fits.at(j)->GetFitLimitLB() )new_fit = fits.at(j);
+		}
+		integral->SetParentFit( new_fit );
+	}
+
+	for ( unsigned int i = 0; i < fits.size(); ++i ){
+		fits.at(i)->SetParentSpectrum(this);
+	}
+	m_list_of_fits.erase( m_list_of_fits.begin() + n );
+	m_list_of_fits.insert( m_list_of_fits.begin() + n, fits.begin(), fits.end() );
+	delete old_fit;
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
 void SFSpectrum::AddPeak( SFPeak* p ){
 	// Add peak to the list
 	m_list_of_peaks.push_back(p);
@@ -127,36 +166,26 @@ void SFSpectrum::CalculateNumberOfPeaksAndFitParameters(){
 		fit->SetNumberOfFitParameters( num_pars );
 		fit->SetNumberOfPeaks( num_peaks );
 
-		// Now create map from parameter number to peak number
+		// Now build the parameter layout -- common width, then the peaks, then the background
 		unsigned int par_ctr = 0;
+		fit->SetFitParameter( par_ctr++, { SFFit::FitParameterWidth, -1, 0.0, 0.0, 0.0, false } );
 
 		for ( unsigned int i = 0; i < num_peaks; ++i ){
-			SFPeak *peak = this->GetPeak( fit->GetPeakNumber(i) );
-			
-			// Set bound width parameter on first peak for convenience...
-			if ( i == 0 ){
-				fit->SetPeakNumberMap( par_ctr, -1 );
-				par_ctr++;
-			}
-			
-			// Set other properties
-			if ( peak->IsDoublet() || peak->IsUnbound() || peak->HasFixedWidth() ){
-				for ( unsigned int j = 0; j < 3; ++j ){
-					fit->SetPeakNumberMap( par_ctr, fit->GetPeakNumber(i) );	// Width scale, amplitude, mean
-					par_ctr++;
-				}
+			int peak_num = fit->GetPeakNumber(i);
+			SFPeak *peak = this->GetPeak( peak_num );
+
+			if ( peak->HasFixedWidth() ){
+				fit->SetFitParameter( par_ctr++, { SFFit::FitParameterWidth, peak_num, 0.0, 0.0, 0.0, true } );
 			}
-			else{
-				for ( unsigned int j = 0; j < 2; ++j ){
-					fit->SetPeakNumberMap( par_ctr, fit->GetPeakNumber(i) ); // Amplitude, mean
-					par_ctr++;
-				}
+			else if ( peak->IsDoublet() || peak->IsUnbound() ){
+				fit->SetFitParameter( par_ctr++, { SFFit::FitParameterWidthScale, peak_num, 0.0, 0.0, 0.0, false } );
 			}
+			fit->SetFitParameter( par_ctr++, { SFFit::FitParameterAmplitude, peak_num, 0.0, 0.0, 0.0, false } );
+			fit->SetFitParameter( par_ctr++, { SFFit::FitParameterMean, peak_num, 0.0, 0.0, 0.0, false } );
 		}
 
 		for ( unsigned int i = 0; i <= fit->GetBGPolyOrder(); ++i ){
-			fit->SetPeakNumberMap( par_ctr, i );
-			par_ctr++;
+			fit->SetFitParameter( par_ctr++, { SFFit::FitParameterBackground, (int)i, 0.0, 0.0, 0.0, false } );
 		}
 
 		// Check par_ctr = num_pars
@@ -164,12 +193,186 @@ void SFSpectrum::CalculateNumberOfPeaksAndFitParameters(){
 			log->Warning( Form( "SFSpectrum::CalculateNumberOfPeaksAndFitParameters -- Tried assigning parameters to peak numbers and didn't get the right numbers to match...num pars = %d whereas I counted %d?", num_pars, par_ctr ) );
 		}
 
+		SetFitParameterValues( fit );
 	}
 	return;
 }
+///////////////////////////////////////////////////////////////////////////////
+// Refill the starting values of every fit from the peaks and backgrounds
+void SFSpectrum::UpdateFitParameterValues(){
+	for ( unsigned int i = 0; i < this->GetNumberOfFits(); ++i ){
+		SetFitParameterValues( this->GetFit(i) );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Starting value, limits and fixed flag of each parameter in the layout
+void SFSpectrum::SetFitParameterValues( SFFit *fit ){
+	for ( unsigned int j = 0; j < fit->GetNumberOfFitParameters(); ++j ){
+		SFFit::FitParameter par = fit->GetFitParameter(j);
+		SFPeak *p = ( par.type != SFFit::FitParameterBackground ? this->GetPeak( par.peak ) : nullptr );
+
+		switch ( par.type ){
+			case SFFit::FitParameterWidth:
+				// The common width
+				if ( p == nullptr ){
+					par.value = m_bound_width;
+					par.lb = m_bound_width_lb;
+					par.ub = m_bound_width_ub;
+					par.fixed = m_bound_width_fixed;
+				}
+				// Fixed width
+				else{
+					par.value = p->GetWidth();
+					par.fixed = true;
+				}
+				break;
 
+			case SFFit::FitParameterWidthScale:
+				// A warm start carries the previous width, so continue from its ratio to the bound width
+				par.value = 1.01;
+				if ( m_warm_start && p->GetWidth() > 0 && m_bound_width > 0 ){
+					par.value = TMath::Min( TMath::Max( p->GetWidth()/m_bound_width, 1.01 ), 2.99 );
+				}
+				par.lb = 1.0;
+				par.ub = 3.0;
+				par.fixed = false;
+				break;
 
+			case SFFit::FitParameterAmplitude:
+				par.value = p->GetAmplitude();
+				par.lb = p->GetAmplitudeLB();
+				par.ub = p->GetAmplitudeUB();
+				par.fixed = p->HasFixedAmplitude();
+				break;
 
+			case SFFit::FitParameterMean:
+				par.value = p->GetMean();
+				par.lb = p->GetMeanLB();
+				par.ub = p->GetMeanUB();
+				par.fixed = p->HasFixedMean();
+				break;
 
+			case SFFit::FitParameterBackground:
+				// Peak number denotes the order of the parameter
+				par.value = fit->GetBGPoly( par.peak );
+				par.lb = fit->GetBGPolyLB( par.peak );
+				par.ub = fit->GetBGPolyUB( par.peak );
+				par.fixed = fit->IsBGPolyFixed( par.peak );
+				break;
 
+			default:
+				log->Warning( Form( "SFSpectrum::SetFitParameterValues -- Parameter %02d has no type", j ) );
+				break;
+		}
 
+		if ( par.fixed ){
+			par.lb = par.value;
+			par.ub = par.value;
+		}
+		fit->SetFitParameter( j, par );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Copy the centres and contents of all bins with centres between lb and ub into
+// contiguous arrays, ready for the vectorised fit kernel
+void SFSpectrum::GetBinArrays( const double lb, const double ub, std::vector<double> &x, std::vector<double> &y ) const {
+	x.resize(0);
+	y.resize(0);
+	if ( this->GetNumberOfBins() == 0 ){
+		log->Warning("SFSpectrum::GetBinArrays -- No histogram to take the bins from!");
+		return;
+	}
+
+	// Bins with centres in range are consecutive
+	const int n = this->GetNumberOfBins();
+	int first = 1;
+	while ( first <= n && this->GetBinCentre( first ) < lb )++first;
+	int last = first - 1;
+	while ( last < n && this->GetBinCentre( last + 1 ) <= ub )++last;
+	if ( last < first )return;
+
+	x.resize( last - first + 1 );
+	y.resize( last - first + 1 );
+	for ( int i = first; i <= last; ++i ){
+		x[i-first] = this->GetBinCentre(i);
+	}
+	m_view.GetContents( first, last, y.data() );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFSpectrum::SetHist( const std::shared_ptr<const TH1> &h ){
+	this->SetBinView( SFBinView(h), ( h != nullptr ? h->GetName() : "" ) );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFSpectrum::SetBinView( const SFBinView &view, const TString &name ){
+	m_view = view;
+	m_hist_name = name;
+	this->UpdateBinCache();
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// One pass over the histogram, so that the counts in any range need only two
+// bin lookups. The under- and overflow bins are left out.
+void SFSpectrum::UpdateBinCache(){
+	m_bin_edges = m_view.GetEdges();
+	m_cumulative_counts.assign( m_cumulative_counts.size(), std::vector<double>(0) );
+	m_inverse_bin_width = 0.0;
+
+	const int n = this->GetNumberOfBins();
+	if ( n == 0 )return;
+
+	for ( unsigned int k = 0; k < m_cumulative_counts.size(); ++k ){
+		m_cumulative_counts[k].resize( n + 1 );
+		m_cumulative_counts[k][0] = 0.0;
+	}
+	for ( int i = 1; i <= n; ++i ){
+		double x = this->GetBinCentre(i);
+		double y = m_view.GetContent(i);
+		m_cumulative_counts[0][i] = m_cumulative_counts[0][i-1] + y;
+		m_cumulative_counts[1][i] = m_cumulative_counts[1][i-1] + x*y;
+		m_cumulative_counts[2][i] = m_cumulative_counts[2][i-1] + x*x*y;
+	}
+
+	// Equal bins can be found without a search
+	const double width = ( m_bin_edges[n] - m_bin_edges[0] )/n;
+	bool uniform = true;
+	for ( int i = 1; i <= n && uniform; ++i ){
+		uniform = ( TMath::Abs( this->GetBinWidth(i) - width ) < 1e-9*width );
+	}
+	if ( uniform )m_inverse_bin_width = 1.0/width;
+
+	log->Debug( Form( "SFSpectrum::UpdateBinCache -- Cached %d %s bins of %s", n, ( m_inverse_bin_width > 0.0 ? "equal" : "variable" ), m_hist_name.Data() ) );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+int SFSpectrum::FindBin( const double x ) const {
+	const int n = this->GetNumberOfBins();
+	if ( n <= 0 || x < m_bin_edges[0] )return 0;
+	if ( x >= m_bin_edges[n] )return n + 1;
+
+	if ( m_inverse_bin_width > 0.0 ){
+		// Rounding can put x one bin out at an edge
+		int i = 1 + (int)( ( x - m_bin_edges[0] )*m_inverse_bin_width );
+		if ( i > n )i = n;
+		if ( x < m_bin_edges[i-1] )--i;
+		else if ( x >= m_bin_edges[i] )++i;
+		return i;
+	}
+	return std::upper_bound( m_bin_edges, m_bin_edges + n + 1, x ) - m_bin_edges;
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFSpectrum::GetCountsBelow( const double x, const unsigned int k ) const {
+	if ( k >= m_cumulative_counts.size() ){
+		log->Warning( Form( "SFSpectrum::GetCountsBelow -- Only moments up to %lu are cached, not %u", m_cumulative_counts.size() - 1, k ) );
+		return 0.0;
+	}
+
+	const std::vector<double> &sum = m_cumulative_counts[k];
+	const int i = this->FindBin(x);
+	if ( i <= 0 )return 0.0;
+	if ( i > this->GetNumberOfBins() )return sum.back();
+	return sum[i-1] + ( sum[i] - sum[i-1] )*( x - this->GetBinLowEdge(i) )/this->GetBinWidth(i);
+}
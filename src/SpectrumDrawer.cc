@@ -5,12 +5,14 @@ const std::vector<TString> SFSpectrumDrawer::m_file_formats = { "ps", "eps", "pd
 ///////////////////////////////////////////////////////////////////////////////
 SFSpectrumDrawer::SFSpectrumDrawer(){
 	m_spec = nullptr;
+	m_hist = nullptr;
 	m_file_format_select.resize( m_file_formats.size() );
 	for ( unsigned int i = 0; i < m_file_format_select.size(); ++i ){
 		m_file_format_select.at(i) = false;
 	}
 	m_peak_marker_triangle.resize(0);
 	m_peak_marker_text.resize(0);
+	m_canvas = nullptr;
 	m_canvas_width = -1;
 	m_canvas_height = -1;
 	m_print_file_name = "";
@@ -33,6 +35,7 @@ SFSpectrumDrawer::~SFSpectrumDrawer(){
 	}
 
 	delete m_canvas;
+	delete m_hist;
 	
 	// Resize vectors
 	m_peak_marker_text.resize(0);
@@ -43,6 +46,8 @@ SFSpectrumDrawer::~SFSpectrumDrawer(){
 ///////////////////////////////////////////////////////////////////////////////
 void SFSpectrumDrawer::SetSpectrum( SFSpectrum *spec ){
 	m_spec = spec;
+	delete m_hist;
+	m_hist = nullptr;
 	m_peak_marker_triangle.resize( m_spec->GetNumberOfPeaks() );
 	m_peak_marker_text.resize( m_spec->GetNumberOfPeaks() );
 	for ( unsigned int i = 0; i < m_spec->GetNumberOfPeaks(); ++i ){
@@ -59,7 +64,12 @@ void SFSpectrumDrawer::FormatSpectrum(){
 	}
 
 	// FORMAT THE HISTOGRAM
-	TH1F *h = m_spec->GetHist();
+	if ( m_hist == nullptr )m_hist = m_spec->MakeHist();
+	TH1 *h = m_hist;
+	if ( h == nullptr ){
+		log->Warning("SFSpectrumDrawer::FormatSpectrum -- The spectrum has no bins to draw");
+		return;
+	}
 	h->SetLineWidth(1);
 	h->SetLineColor(kBlack);
 	h->GetXaxis()->SetTitle( m_x_axis_title );
@@ -129,7 +139,7 @@ void SFSpectrumDrawer::DrawSpectrum(){
 	// First draw the histogram on the canvas
 	if ( m_canvas != nullptr ){
 		m_canvas->cd();
-		TH1F *h = m_spec->GetHist();
+		TH1 *h = m_hist;
 		if ( h != nullptr ){
 			h->Draw("SAME");
 
@@ -162,7 +172,7 @@ void SFSpectrumDrawer::DrawSpectrum(){
 				if ( m_spec->GetFit(i)->GetIndividualFit(j) != nullptr )m_spec->GetFit(i)->GetIndividualFit(j)->Draw("SAME");
 
 				// Create peak markers
-				MakePeakMarker( m_spec->GetFit(i)->GetPeakNumber(j) );
+				if ( h != nullptr )MakePeakMarker( m_spec->GetFit(i)->GetPeakNumber(j) );
 			}
 			
 		}
@@ -204,7 +214,7 @@ void SFSpectrumDrawer::PrintCanvas(){
 	if ( m_canvas != nullptr ){
 		for ( unsigned int i = 0; i < m_file_format_select.size(); ++i ){
 			if ( m_file_format_select.at(i) ){
-				m_canvas->Print( m_print_file_name.Append(".").Append( m_file_formats.at(i) ) );
+				m_canvas->Print( m_print_file_name + "." + m_file_formats.at(i) );
 			}
 		}
 	}
@@ -231,7 +241,7 @@ void SFSpectrumDrawer::MakePeakMarker( const unsigned int n ){
 	};
 
 	double base = peak->GetAmplitude() + 1;
-	TH1F *h  = m_spec->GetHist();
+	TH1 *h  = m_hist;
 	for ( int i = -2; i < 3; ++i ){
 		base = TMath::Max( base, h->GetBinContent( h->FindBin( peak->GetMean() ) - i ) );
 	}
@@ -4,6 +4,8 @@
 // Constructor
 SFSpectrumFitter::SFSpectrumFitter(){
 	m_spec = nullptr;
+	m_number_of_threads = 1;
+	m_fit_cache = nullptr;
 	log->Construction("SFSpectrumFitter::SFSpectrumFitter -- SFSpectrumFitter object created");
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -17,7 +19,15 @@ void SFSpectrumFitter::InitialiseSpectrumGuesses(){
 	// Access pointers
 	SFPeak *p;
 	SFFit *fit;
-	TH1F* h = m_spec->GetHist();
+	const int number_of_bins = m_spec->GetNumberOfBins();
+
+	// Start from the peaks found in the histogram (a warm start is better still)
+	if ( m_spec->HasPeakSearch() && !m_spec->IsWarmStarted() ){
+		SeedPeaksFromSearch();
+	}
+
+	// Width that sets the scale for splitting fits (the bound width guess below is not one)
+	const double cluster_width = ( m_spec->GetBoundPeakWidth() > 0 ? m_spec->GetBoundPeakWidth() : m_spec->GetGuessWidth() );
 
 	// Loop over peaks
 	for ( unsigned int i = 0; i < m_spec->GetNumberOfPeaks(); ++i ){
@@ -42,7 +52,10 @@ void SFSpectrumFitter::InitialiseSpectrumGuesses(){
 			if ( m_spec->GetBoundPeakWidthLB() < 0 )m_spec->SetBoundPeakWidthLB( m_spec->GetGuessWidthLB() );
 			if ( m_spec->GetBoundPeakWidthUB() < 0 )m_spec->SetBoundPeakWidthUB( m_spec->GetGuessWidthUB() );
 
-			if ( p->GetAmplitude() < 0 )p->SetAmplitude( h->GetBinContent( h->FindBin( p->GetMean() ) ) );
+			if ( p->GetAmplitude() < 0 ){
+				const int bin = m_spec->FindBin( p->GetMean() );
+				p->SetAmplitude( bin >= 1 && bin <= number_of_bins ? m_spec->GetBinContent( bin ) : 0.0 );
+			}
 			if ( p->GetAmplitudeLB() < 0 )p->SetAmplitudeLB( m_spec->GetGuessAmplitudeFractionLB()*p->GetAmplitude() );
 			if ( p->GetAmplitudeUB() < 0 )p->SetAmplitudeUB( m_spec->GetGuessAmplitudeFractionUB()*p->GetAmplitude() );
 
@@ -71,10 +84,15 @@ void SFSpectrumFitter::InitialiseSpectrumGuesses(){
 				fit->SetBGPolyUB( j, 1e6 );
 			}
 		}
-		if ( fit->GetFitLimitLB() < -5000 )fit->SetFitLimitLB( h->GetBinLowEdge(1) );
-		if ( fit->GetFitLimitUB() < -5000 )fit->SetFitLimitUB( h->GetBinLowEdge(1 + h->GetNbinsX() ) );
+		if ( fit->GetFitLimitLB() < -5000 )fit->SetFitLimitLB( m_spec->GetBinLowEdge(1) );
+		if ( fit->GetFitLimitUB() < -5000 )fit->SetFitLimitUB( m_spec->GetBinUpEdge( number_of_bins ) );
+
 
+	}
 
+	// Independent groups of peaks are quicker to fit separately
+	if ( m_spec->GetFitClusterSeparation() > 0 ){
+		SplitFitsIntoClusters( cluster_width );
 	}
 
 	CheckForFitParameterGuessErrors();
@@ -138,6 +156,146 @@ void SFSpectrumFitter::InitialiseSpectrumGuesses(){
 	return;
 }
 ///////////////////////////////////////////////////////////////////////////////
+// Fill in the peaks from SFPeakFinder if the config file lists none, otherwise
+// move each listed peak onto the nearest one found. Values given in the config
+// file are kept, and a peak found near two listed peaks (e.g. a doublet) is
+// left alone, as the search cannot resolve them. So is a peak found outside the
+// listed peak's Mean_LB/Mean_UB.
+void SFSpectrumFitter::SeedPeaksFromSearch(){
+	std::vector<double> x, y;
+	m_spec->GetBinArrays( m_spec->GetBinLowEdge(1), m_spec->GetBinUpEdge( m_spec->GetNumberOfBins() ), x, y );
+
+	SFPeakFinder finder;
+	finder.Search( x, y, m_spec->GetGuessWidth(), m_spec->GetPeakSearchThreshold() );
+
+	// Fill in -- only peaks that some fit will see
+	if ( m_spec->GetNumberOfPeaks() == 0 ){
+		for ( unsigned int i = 0; i < finder.GetNumberOfCandidates(); ++i ){
+			const SFPeakFinder::Candidate &c = finder.GetCandidate(i);
+			bool in_fit = ( m_spec->GetNumberOfFits() == 0 );
+			for ( unsigned int j = 0; j < m_spec->GetNumberOfFits(); ++j ){
+				SFFit *fit = m_spec->GetFit(j);
+				if ( c.mean >= fit->GetFitLimitLB() && c.mean < fit->GetFitLimitUB() )in_fit = true;
+			}
+			if ( !in_fit )continue;
+
+			SFPeak *p = new SFPeak();
+			p->SetMean( c.mean );
+			p->SetAmplitude( c.amplitude );
+			p->SetWidth( c.width );
+			if ( m_spec->GetSeparationEnergy() == -1 || p->GetMean() < m_spec->GetSeparationEnergy() ){
+				p->SetBound();
+			}
+			else{
+				p->SetUnbound();
+			}
+			m_spec->AddPeak(p);
+			log->Debug( Form( "SFSpectrumFitter::SeedPeaksFromSearch -- Added peak %02d at %8.4f (%.1f sigma)", m_spec->GetNumberOfPeaks() - 1, c.mean, c.significance ) );
+		}
+	}
+	// Refine
+	else{
+		std::vector<int> nearest( m_spec->GetNumberOfPeaks(), -1 );
+		std::vector<unsigned int> number_of_claims( finder.GetNumberOfCandidates(), 0 );
+		for ( unsigned int i = 0; i < m_spec->GetNumberOfPeaks(); ++i ){
+			if ( m_spec->GetPeak(i)->GetMean() < 0 )continue;
+			nearest.at(i) = finder.FindNearestCandidate( m_spec->GetPeak(i)->GetMean(), m_spec->GetGuessMeanHalfWidth() );
+
+			// A peak found outside the limits given for the mean is not this one
+			if ( nearest.at(i) >= 0 ){
+				const double mean = finder.GetCandidate( nearest.at(i) ).mean;
+				if ( ( m_spec->GetPeak(i)->GetMeanLB() >= 0 && mean < m_spec->GetPeak(i)->GetMeanLB() ) || ( m_spec->GetPeak(i)->GetMeanUB() >= 0 && mean > m_spec->GetPeak(i)->GetMeanUB() ) ){
+					nearest.at(i) = -1;
+				}
+			}
+			if ( nearest.at(i) >= 0 )number_of_claims.at( nearest.at(i) )++;
+		}
+
+		double bound_width_sum = 0.0;
+		unsigned int bound_width_count = 0;
+		for ( unsigned int i = 0; i < m_spec->GetNumberOfPeaks(); ++i ){
+			SFPeak *p = m_spec->GetPeak(i);
+			if ( nearest.at(i) < 0 || number_of_claims.at( nearest.at(i) ) > 1 ){
+				log->Debug( Form( "SFSpectrumFitter::SeedPeaksFromSearch -- No separate peak found near peak %02d", i ) );
+				continue;
+			}
+			const SFPeakFinder::Candidate &c = finder.GetCandidate( nearest.at(i) );
+
+			if ( !p->HasFixedMean() )p->SetMean( c.mean );
+			if ( !p->HasFixedAmplitude() && p->GetAmplitude() < 0 )p->SetAmplitude( c.amplitude );
+			if ( !p->HasFixedWidth() && p->GetWidth() < 0 && ( p->IsDoublet() || p->IsUnbound() ) ){
+				p->SetWidth( c.width );
+			}
+			else if ( !p->HasFixedWidth() && p->IsBound() && !p->IsDoublet() ){
+				bound_width_sum += c.width;
+				bound_width_count++;
+			}
+			log->Debug( Form( "SFSpectrumFitter::SeedPeaksFromSearch -- Peak %02d found at %8.4f (%.1f sigma)", i, c.mean, c.significance ) );
+		}
+
+		// The bound peaks share one width
+		if ( bound_width_count > 0 && m_spec->GetBoundPeakWidth() < 0 ){
+			m_spec->SetBoundPeakWidth( bound_width_sum/bound_width_count );
+		}
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Split each fit wherever neighbouring peaks are more than FitClusterSeparation
+// widths apart, putting the new fit limits half way between them. Every part
+// keeps the background settings of the original fit. Bound peaks are measured in
+// bound_width, and peaks with a width of their own in the larger of the two.
+void SFSpectrumFitter::SplitFitsIntoClusters( const double bound_width ){
+	const double separation = m_spec->GetFitClusterSeparation();
+
+	for ( unsigned int i = 0; i < m_spec->GetNumberOfFits(); ++i ){
+		SFFit *fit = m_spec->GetFit(i);
+
+		// Mean and width of the peaks in this fit, in order of mean
+		std::vector< std::pair<double,double> > peaks;
+		for ( unsigned int j = 0; j < m_spec->GetNumberOfPeaks(); ++j ){
+			SFPeak *p = m_spec->GetPeak(j);
+			if ( p->GetMean() < fit->GetFitLimitLB() || p->GetMean() >= fit->GetFitLimitUB() )continue;
+
+			double width = bound_width;
+			if ( p->HasFixedWidth() )width = p->GetWidth();
+			else if ( p->IsDoublet() || p->IsUnbound() )width = TMath::Max( p->GetWidth(), width );
+			peaks.push_back( std::make_pair( p->GetMean(), width ) );
+		}
+		std::sort( peaks.begin(), peaks.end() );
+
+		std::vector<double> limits( 1, fit->GetFitLimitLB() );
+		for ( unsigned int j = 1; j < peaks.size(); ++j ){
+			double gap = peaks.at(j).first - peaks.at(j-1).first;
+			if ( gap > separation*TMath::Max( peaks.at(j).second, peaks.at(j-1).second ) ){
+				limits.push_back( 0.5*( peaks.at(j).first + peaks.at(j-1).first ) );
+			}
+		}
+		if ( limits.size() == 1 )continue;
+		limits.push_back( fit->GetFitLimitUB() );
+
+		std::vector<SFFit*> parts;
+		for ( unsigned int j = 0; j + 1 < limits.size(); ++j ){
+			SFFit *part = new SFFit();
+			part->SetFitLimitLB( limits.at(j) );
+			part->SetFitLimitUB( limits.at(j+1) );
+			part->SetBGPolyOrder( fit->GetBGPolyOrder() );
+			for ( unsigned int k = 0; k <= fit->GetBGPolyOrder(); ++k ){
+				part->SetBGPoly( k, fit->GetBGPoly(k) );
+				part->SetBGPolyLB( k, fit->GetBGPolyLB(k) );
+				part->SetBGPolyUB( k, fit->GetBGPolyUB(k) );
+				part->SetBGPolyFixed( k, fit->IsBGPolyFixed(k) );
+			}
+			parts.push_back( part );
+		}
+		log->Debug( Form( "SFSpectrumFitter::SplitFitsIntoClusters -- Split fit %d into %d fits", i, (int)parts.size() ) );
+
+		m_spec->ReplaceFit( i, parts );
+		i += parts.size() - 1;
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
 void SFSpectrumFitter::CheckForFitParameterGuessErrors(){
 
 	// LOOP over the number of peaks in the spectrum
@@ -273,15 +431,18 @@ void SFSpectrumFitter::GenerateInitialFits(){
 	SFFit* fit;
 	for ( unsigned int i = 0; i < m_spec->GetNumberOfFits(); ++i ){
 		fit = m_spec->GetFit(i);
+		// Label the fit parameters and build the compiled model from them (the string is kept for reference only)
 		TString fit_func_string = fit->GenerateTotalFitString( 0 );
-		fit_func = new TF1( Form( "%d_FitFunc", i ), fit_func_string, fit->GetFitLimitLB(), fit->GetFitLimitUB() );
+		SFFitFunction model( fit, 0 );
+		fit_func = new TF1( Form( "%d_FitFunc", i ), model, fit->GetFitLimitLB(), fit->GetFitLimitUB(), model.GetNumberOfParameters() );
 		fit->SetFit( fit_func );
 
 		log->Debug( Form( "SFSpectrumFitter::GenerateInitialFits -- %d fit string: %s", i, fit_func_string.Data() ) );
 
 		// Generate individual fits too
+		SFFitFunction individual_model( fit, 1 );
 		for ( unsigned int j = 0; j < fit->GetNumberOfPeaks(); ++j ){
-			fit_func = new TF1( Form( "%d_FitFuncInd_%02d", i, j ), fit->GenerateTotalFitString( 1 ), fit->GetFitLimitLB(), fit->GetFitLimitUB() );
+			fit_func = new TF1( Form( "%d_FitFuncInd_%02d", i, j ), individual_model, fit->GetFitLimitLB(), fit->GetFitLimitUB(), individual_model.GetNumberOfParameters() );
 			fit->SetIndividualFit( j, fit_func );
 		}
 	}
@@ -295,100 +456,36 @@ void SFSpectrumFitter::SetFittingOptions(){
 		SFFit *fit = m_spec->GetFit(i);
 		TF1* fit_func = fit->GetFit();
 
-		// Now set/fix all of the parameters
+		// Now set/fix all of the parameters from the layout table
 		for ( unsigned int j = 0; j < fit->GetNumberOfFitParameters(); ++j ){
-			// Get peak info for this parameter
-			SFPeak *p;
-			int peak_num = fit->GetPeakNumberMap(j);
-			SFFit::FitParameterType type = fit->GetFitParameterType(j);
-
-			// Set the bound-fit width
-			if ( j == 0 && peak_num == -1 && type == SFFit::FitParameterWidth ){
-				if ( m_spec->HasFixedBoundPeakWidth() ){
-					fit_func->FixParameter( j, m_spec->GetBoundPeakWidth() );
-				}
-				else{
-					fit_func->SetParameter( j, m_spec->GetBoundPeakWidth() );
-					fit_func->SetParLimits( j, m_spec->GetBoundPeakWidthLB(), m_spec->GetBoundPeakWidthUB() );
-				}
+			const SFFit::FitParameter &par = fit->GetFitParameter(j);
+			if ( par.fixed ){
+				fit_func->FixParameter( j, par.value );
 			}
-
-			// Start assigning values
-			if ( peak_num >= 0 ){
-				p = m_spec->GetPeak( peak_num );
-
-				// WIDTHS
-				if ( type == SFFit::FitParameterWidth ){
-					// Should only be setting these if a doublet or unbound
-					if ( p->IsDoublet() || p->IsUnbound() || p->HasFixedWidth() ){
-							fit_func->FixParameter( j, p->GetWidth() );
-					}
-					else{
-						log->Warning("Parameter labelled width does not satisfy the requirements...");
-					}
-				}
-				// WIDTH SCALING FACTORS
-				// Shouldn't have any fixed widths here...
-				if ( type == SFFit::FitParameterWidthScale ){
-					if ( p->HasFixedWidth() ){
-						log->Warning("Parameter labelled width-scale does not satisfy the requirements...");
-					}
-					else{
-						fit_func->SetParameter( j, 1.01 );
-						fit_func->SetParLimits( j, 1.0, 3.0 );
-					}
-				}
-				// AMPLITUDES
-				else if ( type == SFFit::FitParameterAmplitude ){
-					if ( p->HasFixedAmplitude() ){
-						fit_func->FixParameter( j, p->GetAmplitude() );
-					}
-					else{
-						fit_func->SetParameter( j, p->GetAmplitude() );
-						fit_func->SetParLimits( j, p->GetAmplitudeLB(), p->GetAmplitudeUB() );
-					}
-				}
-				// MEANS
-				else if ( type == SFFit::FitParameterMean){
-					if ( p->HasFixedMean() ){
-						fit_func->FixParameter( j, p->GetMean() );
-					}
-					else{
-						fit_func->SetParameter( j, p->GetMean() );
-						fit_func->SetParLimits( j, p->GetMeanLB(), p->GetMeanUB() );
-					}
-				}
-				// BACKGROUNDS
-				else if ( type == SFFit::FitParameterBackground ){
-					// Peak number denotes the order of the parameter
-					if ( fit->IsBGPolyFixed(peak_num) ){
-						fit_func->FixParameter( j, fit->GetBGPoly(peak_num) );
-					}
-					else{
-						fit_func->SetParameter( j, fit->GetBGPoly(peak_num) );
-						fit_func->SetParLimits( j, fit->GetBGPolyLB(peak_num), fit->GetBGPolyUB(peak_num) );
-					}
-				}
+			else{
+				fit_func->SetParameter( j, par.value );
+				fit_func->SetParLimits( j, par.lb, par.ub );
 			}
+
 			// Names
-			TString num = ( fit->GetPeakNumberMap(j) >= 0 ? Form( "%02d-", fit->GetPeakNumberMap(j) ) : "" );
+			TString num = ( par.peak >= 0 ? Form( "%02d-", par.peak ) : "" );
 			TString name = "fail";
-			if ( type == SFFit::FitParameterWidth ){
+			if ( par.type == SFFit::FitParameterWidth ){
 				name = "width";
 			}
-			else if ( type == SFFit::FitParameterWidthScale ){
+			else if ( par.type == SFFit::FitParameterWidthScale ){
 				name = "wscale";
 			}
-			else if ( type == SFFit::FitParameterAmplitude ){
+			else if ( par.type == SFFit::FitParameterAmplitude ){
 				name = "amp";
 			}
-			else if ( type == SFFit::FitParameterMean ){
+			else if ( par.type == SFFit::FitParameterMean ){
 				name = "mean";
 			}
-			else if ( type == SFFit::FitParameterBackground ){
+			else if ( par.type == SFFit::FitParameterBackground ){
 				name = "bg";
 			}
-			else if ( type == SFFit::FitParameterNULL ){
+			else if ( par.type == SFFit::FitParameterNULL ){
 				name = "null";
 			}
 			fit_func->SetParName( j, num + name );
@@ -414,11 +511,18 @@ void SFSpectrumFitter::UpdateSpectrumWithFitParameters( SFFit *fit ){
 
 	// Loop over fit parameters
 	for ( unsigned int j = 0; j < fit_result->NPar(); ++j ){
-		SFFit::FitParameterType type = fit->GetFitParameterType(j);
-		int peak_num = fit->GetPeakNumberMap(j);
-		SFPeak *peak = m_spec->GetPeak(peak_num);
+		SFFit::FitParameterType type = fit->GetFitParameter(j).type;
+		int peak_num = fit->GetFitParameter(j).peak;
+		SFPeak *peak = ( type != SFFit::FitParameterBackground ? m_spec->GetPeak(peak_num) : nullptr );
 		bool null_peak_flag = ( peak == nullptr );
 
+		// Parameters hold the spectrum's peak number, but the covariance indices follow this fit's peaks
+		int peak_index = ( type != SFFit::FitParameterBackground ? fit->GetPeakIndex(peak_num) : -1 );
+		if ( !null_peak_flag && peak_index < 0 ){
+			log->Warning( Form( "SFSpectrumFitter::UpdateSpectrumWithFitParameters -- Peak %02d is not in this fit", peak_num ) );
+			null_peak_flag = true;
+		}
+
 		// Store the value based on type
 		if ( type == SFFit::FitParameterWidth ){
 			if ( j == 0 ){
@@ -436,7 +540,7 @@ void SFSpectrumFitter::UpdateSpectrumWithFitParameters( SFFit *fit ){
 					peak->SetWidth( fit_result->Parameter(j) );
 					peak->SetWidthErr( fit_result->ParError(j) );
 					peak->SetLimitedWidth( IsParameterAtLimit(j, fit_result) );
-					cov_index_amp_wid.at(peak_num).at(0) = j;
+					cov_index_amp_wid.at(peak_index).at(0) = j;
 				}
 				else{
 					log->Warning("Trying to access peak with weird peak number and weird properties...investigate further!");
@@ -457,7 +561,7 @@ void SFSpectrumFitter::UpdateSpectrumWithFitParameters( SFFit *fit ){
 			peak->SetAmplitude( fit_result->Parameter(j) );
 			peak->SetAmplitudeErr( fit_result->ParError(j) );
 			peak->SetLimitedAmplitude( IsParameterAtLimit(j, fit_result) );
-			cov_index_amp_wid.at(peak_num).at(1) = j;
+			cov_index_amp_wid.at(peak_index).at(1) = j;
 		}
 		else if ( type == SFFit::FitParameterBackground ){
 			fit->SetBGPoly( peak_num, fit_result->Parameter(j) );
@@ -466,8 +570,8 @@ void SFSpectrumFitter::UpdateSpectrumWithFitParameters( SFFit *fit ){
 
 			// Covariance matrix terms for background integrals...
 			for ( unsigned int k = 0; k < j; ++k ){
-				if( fit->GetFitParameterType(k) == SFFit::FitParameterBackground ){
-					fit->SetBGCovMatrix( fit->GetPeakNumberMap(j), fit->GetPeakNumberMap(k), fit_result->CovMatrix( j, k ) );
+				if( fit->GetFitParameter(k).type == SFFit::FitParameterBackground ){
+					fit->SetBGCovMatrix( peak_num, fit->GetFitParameter(k).peak, fit_result->CovMatrix( j, k ) );
 				}
 			}
 			
@@ -487,10 +591,10 @@ void SFSpectrumFitter::UpdateSpectrumWithFitParameters( SFFit *fit ){
 
 		// Check area has not already been set...
 		if ( peak->GetArea() >= 0 ){
-			log->Warning( Form( "Peak %02d area has already been set -- perhaps by another fit? Will overwrite...", j ) );
+			log->Warning( Form( "Peak %02d area has already been set -- perhaps by another fit? Will overwrite...", fit->GetPeakNumber(j) ) );
 		}
 
-		peak->SetArea( peak->GetAmplitude()*peak->GetWidth()*sqrt2pi/m_spec->GetHist()->GetBinWidth(0) );
+		peak->SetArea( peak->GetAmplitude()*peak->GetWidth()*sqrt2pi/m_spec->GetBinWidth(1) );
 
 		// Calculate error
 		if ( cov_index_amp_wid.at(j).at(0) == -1 || cov_index_amp_wid.at(j).at(1) == -1 ){
@@ -507,16 +611,39 @@ void SFSpectrumFitter::UpdateSpectrumWithFitParameters( SFFit *fit ){
 }
 ///////////////////////////////////////////////////////////////////////////////
 void SFSpectrumFitter::FitPeaks(){
-	// Fit the histogram (bound)
-	// 0 -> don't draw fit automatically
-	// S -> return TFitResultPtr
-	// L -> hist represents counts, so fits better when empty bins are present. Log-likelihood method rather than chi-squared...
+	FitAllWindows();
+
+	// Fits split into clusters should still agree on the bound peak width
+	if ( m_spec->HasFitClusterJointWidth() && !m_spec->HasFixedBoundPeakWidth() && m_spec->GetNumberOfFits() > 1 ){
+		FitWithJointBoundPeakWidth();
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFSpectrumFitter::FitAllWindows(){
+	// Fit the histogram (bound) with a binned Poisson log-likelihood, using the
+	// analytic gradient of the model (see FitWithAnalyticGradient). Each SFFit has
+	// its own TF1 and fit window, so the fits are independent and can be run on
+	// several threads. Only the minimisation happens there -- the results are
+	// merged into the shared peaks afterwards, in fit order, so the output does
+	// not depend on the number of threads.
+	std::vector<TFitResultPtr> results( m_spec->GetNumberOfFits() );
+	SFThreadPool pool( m_number_of_threads );
+	if ( pool.GetNumberOfThreads() > 1 ){
+		ROOT::EnableThreadSafety();
+	}
+	const int timer = SFProfiler::GetInstance()->GetCurrentTimer();
+	pool.Execute( m_spec->GetNumberOfFits(), [&]( unsigned int i ){
+		SFProfiler::Timer fit_timer( Form( "Fit %02d", i ), timer );
+		results.at(i) = FitWithAnalyticGradient( m_spec->GetFit(i) );
+	} );
+
 	for ( unsigned int i = 0; i < m_spec->GetNumberOfFits(); ++i ){
 		SFFit *fit = m_spec->GetFit(i);
-		TFitResultPtr r = m_spec->GetHist()->Fit( fit->GetFit(), "0SL" );
-		fit->SetFitResultPtr(r);
+		fit->SetFitResultPtr( results.at(i) );
 
 		log->Debug( Form( "SFSpectrumFitter::FitPeaks -- Fitted spectrum with guessed parameters (fit %d)", i ) );
+		LogTelemetry( fit, i );
 
 		// Store the fit parameters in the spectrum + peak objects
 		UpdateSpectrumWithFitParameters( fit );
@@ -554,6 +681,232 @@ void SFSpectrumFitter::FitPeaks(){
 	return;
 }
 ///////////////////////////////////////////////////////////////////////////////
+// Fit again with the bound peak width fixed to the mean of the widths found by
+// each fit, weighted by their errors, starting from the first results. The
+// error on that mean is added back to the widths and areas afterwards.
+void SFSpectrumFitter::FitWithJointBoundPeakWidth(){
+	double sum_weights = 0.0;
+	double sum_widths = 0.0;
+	for ( unsigned int i = 0; i < m_spec->GetNumberOfFits(); ++i ){
+		SFFit *fit = m_spec->GetFit(i);
+		TFitResultPtr r = fit->GetFitResultPtr();
+		if ( !r->IsValid() || r->ParError(0) <= 0 )continue;
+
+		// Only fits with a peak that depends on the bound peak width
+		bool uses_width = false;
+		for ( unsigned int j = 0; j < fit->GetNumberOfPeaks(); ++j ){
+			if ( !m_spec->GetPeak( fit->GetPeakNumber(j) )->HasFixedWidth() )uses_width = true;
+		}
+		if ( !uses_width )continue;
+
+		double weight = 1.0/( r->ParError(0)*r->ParError(0) );
+		sum_weights += weight;
+		sum_widths += weight*r->Parameter(0);
+	}
+	if ( sum_weights <= 0 ){
+		log->Warning("SFSpectrumFitter::FitWithJointBoundPeakWidth -- No fit gives the bound peak width -- skipping the joint fit");
+		return;
+	}
+	double width = sum_widths/sum_weights;
+	double width_err = 1.0/TMath::Sqrt( sum_weights );
+	log->Debug( Form( "SFSpectrumFitter::FitWithJointBoundPeakWidth -- Bound peak width %8.4f +/- %8.4f", width, width_err ) );
+
+	for ( unsigned int i = 0; i < m_spec->GetNumberOfPeaks(); ++i ){
+		m_spec->GetPeak(i)->SetArea(-1.0);
+		m_spec->GetPeak(i)->SetAreaErr(-1.0);
+	}
+	m_spec->SetBoundPeakWidth( width );
+	m_spec->SetFixedBoundPeakWidth( true );
+	m_spec->UpdateFitParameterValues();
+	SetFittingOptions();
+	FitAllWindows();
+	m_spec->SetFixedBoundPeakWidth( false );
+
+	for ( unsigned int i = 0; i < m_spec->GetNumberOfPeaks(); ++i ){
+		SFPeak *peak = m_spec->GetPeak(i);
+		if ( peak->HasFixedWidth() || peak->GetArea() <= 0 || peak->GetAreaErr() < 0 )continue;
+
+		double rel_err = width_err/width;
+		peak->SetWidthErr( peak->GetWidth()*TMath::Sqrt( TMath::Power( peak->GetWidthErr()/peak->GetWidth(), 2 ) + rel_err*rel_err ) );
+		peak->SetAreaErr( peak->GetArea()*TMath::Sqrt( TMath::Power( peak->GetAreaErr()/peak->GetArea(), 2 ) + rel_err*rel_err ) );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Equivalent of TH1::Fit( fit, "0SL" ), but the likelihood is evaluated over all
+// bins of the fit window at once by the vectorised SFFitKernel, and Minuit2 is
+// handed the analytic gradient so it does not differentiate numerically. The
+// bin slice is extracted once and the objective goes straight to the minimiser,
+// without the data handling of TH1::Fit or ROOT::Fit::Fitter. The parameter
+// values, limits and fixed flags are taken from the TF1, which is updated with
+// the result afterwards so it can still be drawn.
+TFitResultPtr SFSpectrumFitter::FitWithAnalyticGradient( SFFit *fit ){
+	const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	SFFit::FitTelemetry telemetry = { 0, 0, 0, 0.0, false };
+	TF1 *fit_func = fit->GetFit();
+	SFFitFunction model( fit, 0 );
+
+	// Contiguous bin arrays for the fit window (empty bins are needed for the likelihood)
+	std::vector<double> x, y;
+	m_spec->GetBinArrays( fit->GetFitLimitLB(), fit->GetFitLimitUB(), x, y );
+	SFLikelihoodFunction likelihood( model, x, y );
+	likelihood.SetPeakRange( m_spec->GetPeakEvaluationRange() );
+
+	// An identical fit (same bins and same starting point) has been done before
+	TString cache_key;
+	if ( m_fit_cache != nullptr ){
+		cache_key = m_fit_cache->GetKey( fit_func, x, y, Form( "PeakRange=%g;VariableProjection=%d", likelihood.GetPeakRange(), m_spec->UsesVariableProjection() ) );
+		SFFitResult *cached = m_fit_cache->Load( cache_key, fit_func );
+		if ( cached != nullptr ){
+			log->Debug( Form( "SFSpectrumFitter::FitWithAnalyticGradient -- Using cached fit %s between %8.4f and %8.4f", cache_key.Data(), fit->GetFitLimitLB(), fit->GetFitLimitUB() ) );
+			fit_func->SetParameters( cached->GetParams() );
+			fit_func->SetParErrors( cached->GetErrors() );
+			fit_func->SetChisquare( cached->Chi2() );
+			fit_func->SetNDF( cached->Ndf() );
+
+			telemetry.cached = true;
+			telemetry.time = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_time ).count();
+			fit->SetTelemetry( telemetry );
+			return TFitResultPtr( cached );
+		}
+	}
+
+	// Starting values and limits (equal for fixed parameters, infinite if not limited)
+	const unsigned int npar = model.NPar();
+	std::vector<double> p( npar ), lb( npar ), ub( npar );
+	for ( unsigned int j = 0; j < npar; ++j ){
+		p[j] = fit_func->GetParameter(j);
+		fit_func->GetParLimits( j, lb[j], ub[j] );
+
+		// TF1::FixParameter sets lb = ub = value, or lb > ub when the value is 0
+		if ( lb[j] >= ub[j] && ( lb[j] != 0.0 || ub[j] != 0.0 ) ){
+			lb[j] = ub[j] = p[j];
+		}
+		else if ( !( lb[j] < ub[j] ) ){
+			lb[j] = -std::numeric_limits<double>::infinity();
+			ub[j] = std::numeric_limits<double>::infinity();
+		}
+	}
+
+	// Find the minimum in the means and widths alone first
+	if ( m_spec->UsesVariableProjection() ){
+		SFProfiler::Timer timer("VariableProjection");
+		telemetry.iterations += FindProjectedMinimum( fit, likelihood, model, x, y, lb, ub, p );
+	}
+
+	// Set up the minimiser
+	std::unique_ptr<ROOT::Math::Minimizer> minimizer( ROOT::Math::Factory::CreateMinimizer( "Minuit2", "Migrad" ) );
+	if ( minimizer == nullptr ){
+		log->Error("SFSpectrumFitter::FitWithAnalyticGradient -- Could not create the Minuit2 minimiser. Is ROOT built with Minuit2?");
+	}
+	minimizer->SetFunction( likelihood );
+
+	// The likelihood chi-squared is minimised, so an error definition of 1 applies
+	minimizer->SetErrorDef( 1.0 );
+
+	for ( unsigned int j = 0; j < npar; ++j ){
+		SetMinimizerVariable( minimizer.get(), j, fit_func->GetParName(j), p[j], lb[j], ub[j] );
+	}
+
+	// Extended likelihood fit, as with option "L" in TH1::Fit
+	SFProfiler::GetInstance()->Start("Migrad");
+	bool is_valid = minimizer->Minimize();
+	SFProfiler::GetInstance()->Stop();
+	if ( !is_valid ){
+		log->Warning( Form( "SFSpectrumFitter::FitWithAnalyticGradient -- Fit between %8.4f and %8.4f did not converge", fit->GetFitLimitLB(), fit->GetFitLimitUB() ) );
+	}
+	log->Debug( Form( "SFSpectrumFitter::FitWithAnalyticGradient -- -ln(L) = %f at the minimum", likelihood.GetNegativeLogLikelihood( minimizer->X() ) ) );
+
+	// Copy the result back to the TF1
+	SFFitResult *result = new SFFitResult( *minimizer, fit_func, is_valid, likelihood.GetNumberOfBins() );
+	fit_func->SetParameters( result->GetParams() );
+	fit_func->SetParErrors( result->GetErrors() );
+	fit_func->SetChisquare( result->Chi2() );
+	fit_func->SetNDF( result->Ndf() );
+
+	if ( m_fit_cache != nullptr ){
+		m_fit_cache->Save( cache_key, result );
+	}
+
+	telemetry.evaluations = likelihood.GetNumberOfEvaluations();
+	telemetry.gradients = likelihood.GetNumberOfGradientEvaluations();
+	telemetry.iterations += minimizer->NIterations();
+	telemetry.time = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_time ).count();
+	fit->SetTelemetry( telemetry );
+
+	return TFitResultPtr( result );
+}
+///////////////////////////////////////////////////////////////////////////////
+// Variable projection: the minimiser only varies the means and widths, and the
+// amplitudes and background are solved for at every step (see
+// SFProjectedLikelihood). p is updated with the minimum, from which the full fit
+// in FitWithAnalyticGradient only has to find the errors. Returns the number of
+// Migrad iterations.
+unsigned int SFSpectrumFitter::FindProjectedMinimum( SFFit *fit, const SFLikelihoodFunction &likelihood, const SFFitFunction &model, const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &lb, const std::vector<double> &ub, std::vector<double> &p ){
+	SFProjectedLikelihood projected( likelihood, model, x, y, p, lb, ub );
+	TF1 *fit_func = fit->GetFit();
+
+	std::unique_ptr<ROOT::Math::Minimizer> minimizer( ROOT::Math::Factory::CreateMinimizer( "Minuit2", "Migrad" ) );
+	if ( minimizer == nullptr ){
+		log->Error("SFSpectrumFitter::FindProjectedMinimum -- Could not create the Minuit2 minimiser. Is ROOT built with Minuit2?");
+	}
+	minimizer->SetFunction( projected );
+	minimizer->SetErrorDef( 1.0 );
+
+	std::vector<double> q( projected.NDim() );
+	unsigned int number_of_free = 0;
+	for ( unsigned int i = 0; i < projected.NDim(); ++i ){
+		unsigned int j = projected.GetParameterIndex(i);
+		q[i] = p[j];
+		SetMinimizerVariable( minimizer.get(), i, fit_func->GetParName(j), p[j], lb[j], ub[j] );
+		if ( lb[j] < ub[j] )number_of_free++;
+	}
+
+	// Nothing to minimise if all of the means and widths are fixed
+	if ( number_of_free > 0 ){
+		if ( !minimizer->Minimize() ){
+			log->Warning( Form( "SFSpectrumFitter::FindProjectedMinimum -- Projected fit between %8.4f and %8.4f did not converge. Continuing with the full fit...", fit->GetFitLimitLB(), fit->GetFitLimitUB() ) );
+		}
+		q.assign( minimizer->X(), minimizer->X() + projected.NDim() );
+	}
+	projected.GetParameters( q.data(), p.data() );
+
+	log->Debug( Form( "SFSpectrumFitter::FindProjectedMinimum -- Minimised over %u of %u parameters, with %u solved for (%u calls)", number_of_free, model.NPar(), projected.GetNumberOfLinearParameters(), minimizer->NCalls() ) );
+	return ( number_of_free > 0 ? minimizer->NIterations() : 0 );
+}
+///////////////////////////////////////////////////////////////////////////////
+// Minuit2 status 0 = converged, covariance status 3 = accurate. Anything else
+// is worth a look, even if the fit counts as valid.
+void SFSpectrumFitter::LogTelemetry( SFFit *fit, const unsigned int n ){
+	const SFFit::FitTelemetry &t = fit->GetTelemetry();
+	TFitResultPtr r = fit->GetFitResultPtr();
+	TString s = Form( "fit %u between %8.4f and %8.4f: status %d, covariance status %d, EDM %g, %u iterations, %lu values, %lu gradients, %.3f s%s", n, fit->GetFitLimitLB(), fit->GetFitLimitUB(), r->Status(), r->CovMatrixStatus(), r->Edm(), t.iterations, t.evaluations, t.gradients, t.time, ( t.cached ? " (cached)" : "" ) );
+	if ( r->Status() != 0 || r->CovMatrixStatus() != 3 ){
+		log->Warning( "SFSpectrumFitter::LogTelemetry -- Minimiser had trouble with " + s );
+	}
+	else{
+		log->Debug( "SFSpectrumFitter::LogTelemetry -- Minimiser telemetry for " + s );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Fixed if lb = ub, limited if both limits are finite
+void SFSpectrumFitter::SetMinimizerVariable( ROOT::Math::Minimizer *minimizer, const unsigned int n, const TString &name, const double value, const double lb, const double ub ){
+	// Initial step size as chosen by TH1::Fit
+	double step = ( value != 0.0 ? 0.3*TMath::Abs( value ) : 0.3 );
+
+	if ( lb >= ub ){
+		minimizer->SetFixedVariable( n, name.Data(), value );
+	}
+	else if ( TMath::Finite( lb ) && TMath::Finite( ub ) ){
+		minimizer->SetLimitedVariable( n, name.Data(), value, TMath::Min( step, 0.5*( ub - lb ) ), lb, ub );
+	}
+	else{
+		minimizer->SetVariable( n, name.Data(), value, step );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
 int SFSpectrumFitter::IsParameterAtLimit( int par_num, TFitResultPtr r ){
 	double lb, ub, par_value;
 	double threshold = 1e-6;
@@ -566,6 +919,7 @@ int SFSpectrumFitter::IsParameterAtLimit( int par_num, TFitResultPtr r ){
 
 void SFSpectrumFitter::CalculateIntegrals(){
 	// Loop over integrals
+	std::vector<SFSpectrumIntegral*> integrals;
 	for ( unsigned int i = 0; i < m_spec->GetNumberOfIntegrals(); ++i ){
 		SFSpectrumIntegral *integral = m_spec->GetIntegral(i);
 
@@ -580,36 +934,38 @@ void SFSpectrumFitter::CalculateIntegrals(){
 				for ( unsigned int j = 0; j <= integral->GetBGPolyOrder(); ++j ){
 					if ( integral->GetBGPoly(j) == -1.0 ){
 						questionable_bg = true;
-
-						if ( questionable_bg ){
-							log->Warning("SFSpectrumFitter::CalculateIntegrals -- I don't believe your background is sensible, so I'm going to say your integral is zero for now. Please amend input to get a better integral...");
-							//integral->SetIntegral(-1.0);
-							//integral->SetIntegralErr(-1.0);
-							return;
-						}
 					}
 				}
+				if ( questionable_bg ){
+					log->Warning("SFSpectrumFitter::CalculateIntegrals -- I don't believe your background is sensible, so I'm going to say your integral is zero for now. Please amend input to get a better integral...");
+					//integral->SetIntegral(-1.0);
+					//integral->SetIntegralErr(-1.0);
+					continue;
+				}
 			}
+			else{
+				// Assign with a background fit - make sure they have the same order!
+				if ( fit->GetBGPolyOrder() != integral->GetBGPolyOrder() ){
+					log->Warning("Parent fit and integral have different orders of background...this should have been fixed earlier");
+				}
 
-			// Assign with a background fit - make sure they have the same order!
-			if ( fit->GetBGPolyOrder() != integral->GetBGPolyOrder() ){
-				log->Warning("Parent fit and integral have different orders of background...this should have been fixed earlier");
-			}
-			
-			for ( unsigned int j = 0; j <= fit->GetBGPolyOrder(); ++j ){
-				integral->SetBGPoly( j, fit->GetBGPoly(j) );
-				integral->SetBGPolyErr( j, fit->GetBGPolyErr(j) );
+				for ( unsigned int j = 0; j <= fit->GetBGPolyOrder(); ++j ){
+					integral->SetBGPoly( j, fit->GetBGPoly(j) );
+					integral->SetBGPolyErr( j, fit->GetBGPolyErr(j) );
 
-				// Covariance matrix
-				for ( unsigned int k = 0; k < j; ++k ){
-					integral->SetBGCovMatrix(j,k, fit->GetBGCovMatrix(j,k) );
+					// Covariance matrix
+					for ( unsigned int k = 0; k < j; ++k ){
+						integral->SetBGCovMatrix(j,k, fit->GetBGCovMatrix(j,k) );
+					}
 				}
 			}
 		}
-
-		// Now calculate the integrals
-		integral->CalculateIntegral();
+		integrals.push_back( integral );
 	}
 
+	// Now calculate the integrals, together so that those with the same background share the work
+	SFIntegralEngine engine;
+	engine.CalculateIntegrals( m_spec, integrals );
+
 	return;
 }
\ No newline at end of file
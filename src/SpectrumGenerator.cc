@@ -0,0 +1,227 @@
+#include "SpectrumGenerator.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFSpectrumGenerator::SFSpectrumGenerator(){
+	m_number_of_peaks = 10;
+	m_number_of_bins = 1000;
+	m_lb = 1000.0;
+	m_ub = 2000.0;
+	m_counts = 1e5;
+	m_background_fraction = 0.2;
+	m_width = -1.0;
+	m_width_model = WidthConstant;
+	m_background_shape = BackgroundFlat;
+	m_seed = 1;
+
+	m_centre_width = -1.0;
+	m_mean.resize(0);
+	m_sigma.resize(0);
+	m_area.resize(0);
+	log->Construction("SFSpectrumGenerator::SFSpectrumGenerator -- SFSpectrumGenerator object constructed");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFSpectrumGenerator::~SFSpectrumGenerator(){
+	m_mean.clear();
+	m_sigma.clear();
+	m_area.clear();
+	log->Construction("SFSpectrumGenerator::~SFSpectrumGenerator -- SFSpectrumGenerator object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+bool SFSpectrumGenerator::GetWidthModel( const TString &s, WidthModel &model ){
+	if ( s == "const" )model = WidthConstant;
+	else if ( s == "sqrt" )model = WidthSqrt;
+	else if ( s == "linear" )model = WidthLinear;
+	else return false;
+	return true;
+}
+///////////////////////////////////////////////////////////////////////////////
+bool SFSpectrumGenerator::GetBackgroundShape( const TString &s, BackgroundShape &shape ){
+	if ( s == "flat" )shape = BackgroundFlat;
+	else if ( s == "linear" )shape = BackgroundLinear;
+	else if ( s == "exp" )shape = BackgroundExponential;
+	else return false;
+	return true;
+}
+///////////////////////////////////////////////////////////////////////////////
+// The width grows with x like a detector resolution, equal to m_centre_width in
+// the middle of the range
+double SFSpectrumGenerator::GetWidthAtX( const double x ) const {
+	double ratio = x/( 0.5*( m_lb + m_ub ) );
+	if ( m_width_model == WidthSqrt )return m_centre_width*TMath::Sqrt( ratio );
+	if ( m_width_model == WidthLinear )return m_centre_width*ratio;
+	return m_centre_width;
+}
+///////////////////////////////////////////////////////////////////////////////
+// t = 0 at the lower edge and 1 at the upper edge. The linear background falls
+// from 1.5 to 0.5 times its mean, and the exponential one by a factor of e^3.
+double SFSpectrumGenerator::GetBackgroundCumulative( const double x ) const {
+	double t = TMath::Min( TMath::Max( ( x - m_lb )/( m_ub - m_lb ), 0.0 ), 1.0 );
+	if ( m_background_shape == BackgroundLinear )return 1.5*t - 0.5*t*t;
+	if ( m_background_shape == BackgroundExponential )return ( 1.0 - TMath::Exp( -3.0*t ) )/( 1.0 - TMath::Exp( -3.0 ) );
+	return t;
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFSpectrumGenerator::GetMinimumWidth() const {
+	double w = m_sigma.size() > 0 ? m_sigma.front() : m_centre_width;
+	for ( unsigned int i = 0; i < m_sigma.size(); ++i ){
+		w = TMath::Min( w, m_sigma.at(i) );
+	}
+	return w;
+}
+///////////////////////////////////////////////////////////////////////////////
+double SFSpectrumGenerator::GetMaximumWidth() const {
+	double w = m_sigma.size() > 0 ? m_sigma.front() : m_centre_width;
+	for ( unsigned int i = 0; i < m_sigma.size(); ++i ){
+		w = TMath::Max( w, m_sigma.at(i) );
+	}
+	return w;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Each peak is moved by up to 10% of the spacing, and its area is between half
+// and one and a half times the average
+void SFSpectrumGenerator::GeneratePeaks(){
+	if ( m_number_of_bins == 0 || !( m_lb < m_ub ) ){
+		log->Error( Form( "SFSpectrumGenerator::GeneratePeaks -- Need at least one bin and LB < UB (%u bins between %g and %g)", m_number_of_bins, m_lb, m_ub ) );
+	}
+	if ( m_width_model != WidthConstant && m_lb <= 0.0 ){
+		log->Error("SFSpectrumGenerator::GeneratePeaks -- The width can only depend on x if the range is above zero");
+	}
+
+	const double spacing = ( m_ub - m_lb )/TMath::Max( m_number_of_peaks, 1u );
+	const double bin_width = ( m_ub - m_lb )/m_number_of_bins;
+	m_centre_width = ( m_width > 0.0 ? m_width : TMath::Max( spacing/8.0, 3.0*bin_width ) );
+
+	TRandom3 rng( m_seed );
+	m_mean.resize( m_number_of_peaks );
+	m_sigma.resize( m_number_of_peaks );
+	m_area.resize( m_number_of_peaks );
+	double area_sum = 0.0;
+	for ( unsigned int i = 0; i < m_number_of_peaks; ++i ){
+		m_mean.at(i) = m_lb + ( i + 0.5 + rng.Uniform( -0.1, 0.1 ) )*spacing;
+		m_sigma.at(i) = GetWidthAtX( m_mean.at(i) );
+		m_area.at(i) = rng.Uniform( 0.5, 1.5 );
+		area_sum += m_area.at(i);
+	}
+	for ( unsigned int i = 0; i < m_number_of_peaks; ++i ){
+		m_area.at(i) *= ( 1.0 - m_background_fraction )*m_counts/area_sum;
+	}
+
+	log->Debug( Form( "SFSpectrumGenerator::GeneratePeaks -- %u peaks with widths from %g to %g", m_number_of_peaks, GetMinimumWidth(), GetMaximumWidth() ) );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Expected counts in each bin, then a Poisson number of counts about them. Each
+// peak only adds to the bins within 8 sigma of its mean, using the difference
+// of the error function across each bin.
+TH1D* SFSpectrumGenerator::GenerateHistogram( const TString &name, const unsigned int noise_index ) const {
+	const double bin_width = ( m_ub - m_lb )/m_number_of_bins;
+	std::vector<double> mu( m_number_of_bins );
+
+	// Background
+	const double background = m_background_fraction*m_counts;
+	double cumulative = GetBackgroundCumulative( m_lb );
+	for ( unsigned int i = 0; i < m_number_of_bins; ++i ){
+		double next = GetBackgroundCumulative( m_lb + ( i + 1 )*bin_width );
+		mu[i] = background*( next - cumulative );
+		cumulative = next;
+	}
+
+	// Peaks
+	for ( unsigned int j = 0; j < m_mean.size(); ++j ){
+		const double scale = 1.0/( TMath::Sqrt2()*m_sigma.at(j) );
+		int first = TMath::Max( TMath::FloorNint( ( m_mean.at(j) - 8.0*m_sigma.at(j) - m_lb )/bin_width ), 0 );
+		int last = TMath::Min( TMath::CeilNint( ( m_mean.at(j) + 8.0*m_sigma.at(j) - m_lb )/bin_width ), (int)m_number_of_bins - 1 );
+		double erf_low = TMath::Erf( ( m_lb + first*bin_width - m_mean.at(j) )*scale );
+		for ( int i = first; i <= last; ++i ){
+			double erf_high = TMath::Erf( ( m_lb + ( i + 1 )*bin_width - m_mean.at(j) )*scale );
+			mu[i] += 0.5*m_area.at(j)*( erf_high - erf_low );
+			erf_low = erf_high;
+		}
+	}
+
+	// A different seed to GeneratePeaks, so the counts do not follow the peak parameters
+	TRandom3 rng( m_seed + 1 + noise_index );
+	TH1D *h = new TH1D( name, Form( "Synthetic spectrum; x; Counts per %g", bin_width ), m_number_of_bins, m_lb, m_ub );
+	h->SetDirectory(nullptr);
+	double entries = 0.0;
+	for ( unsigned int i = 0; i < m_number_of_bins; ++i ){
+		double n = rng.Poisson( mu[i] );
+		h->SetBinContent( i + 1, n );
+		entries += n;
+	}
+	h->SetEntries( entries );
+	return h;
+}
+///////////////////////////////////////////////////////////////////////////////
+// One fit over the whole range. With a constant width all of the peaks are
+// bound and share it; otherwise they are unbound, and their widths can only be
+// 1-3 times the bound peak width, which starts at the narrowest peak.
+void SFSpectrumGenerator::WriteConfigFile( const TString &file_name, const TString &root_file_name, const TString &hist_name ) const {
+	std::ofstream f( file_name.Data() );
+	if ( !f.is_open() ){
+		log->Error( Form( "SFSpectrumGenerator::WriteConfigFile -- Could not open %s", file_name.Data() ) );
+		return;
+	}
+
+	const bool common_width = ( m_width_model == WidthConstant );
+	const double min_width = GetMinimumWidth();
+	if ( GetMaximumWidth() > 3.0*min_width ){
+		log->Warning( Form( "SFSpectrumGenerator::WriteConfigFile -- The widths vary from %g to %g, which is more than the fit allows (a factor of 3)", min_width, GetMaximumWidth() ) );
+	}
+
+	TString fit_file_name = hist_name + "_fit_parameters.dat";
+	const char *model_names[] = { "const", "sqrt", "linear" };
+	const char *shape_names[] = { "flat", "linear", "exp" };
+	const int background_dimension[] = { 0, 1, 2 };
+
+	f << "# Generated by spectrum_generator -p " << m_mean.size() << " -b " << m_number_of_bins << " --lb " << m_lb << " --ub " << m_ub << " -N " << m_counts << " --bg-fraction " << m_background_fraction << " --width " << m_centre_width << " --width-model " << model_names[m_width_model] << " --bg " << shape_names[m_background_shape] << " --seed " << m_seed << std::endl;
+	f << std::endl;
+
+	f << "# FILE OPTIONS" << std::endl;
+	f << "ROOTFile: " << root_file_name << std::endl;
+	f << "ROOTHistName: " << hist_name << std::endl;
+	f << "FitParameterFile: " << fit_file_name << std::endl;
+	f << std::endl;
+
+	f << "# SPECTRUM INFORMATION" << std::endl;
+	f << "NumberOfPeaks: " << m_mean.size() << std::endl;
+	f << "NumberOfFits: 1" << std::endl;
+	f << "NumberOfIntegrals: 0" << std::endl;
+	f << "SeparationEnergy: " << ( common_width ? m_ub : m_lb ) << std::endl;
+	f << std::endl;
+
+	f << "# FIT OPTIONS" << std::endl;
+	f << "BackgroundDimension: " << background_dimension[m_background_shape] << std::endl;
+	f << "00.FitLB: " << m_lb << std::endl;
+	f << "00.FitUB: " << m_ub << std::endl;
+	f << std::endl;
+
+	f << "BoundPeakWidth: " << min_width << std::endl;
+	f << "BoundPeakWidth_LB: " << 0.5*min_width << std::endl;
+	f << "BoundPeakWidth_UB: " << 2.0*min_width << std::endl;
+	f << "GuessMeanHalfWidth: " << min_width << std::endl;
+	f << std::endl;
+
+	f << "# PEAK INFORMATION" << std::endl;
+	f << std::setprecision(10);
+	for ( unsigned int i = 0; i < m_mean.size(); ++i ){
+		f << Form( "%02d.Mean: ", i ) << m_mean.at(i) << std::endl;
+	}
+	f << std::endl;
+
+	// N.B. the area is the integral of the Gaussian in counts, not its height
+	f << "# TRUE VALUES" << std::endl;
+	f << "# Peak\tMean\tWidth\tArea" << std::endl;
+	for ( unsigned int i = 0; i < m_mean.size(); ++i ){
+		f << Form( "# %02d", i ) << "\t" << m_mean.at(i) << "\t" << m_sigma.at(i) << "\t" << m_area.at(i) << std::endl;
+	}
+	f << std::endl;
+
+	f << "# DRAWING" << std::endl;
+	f << "PrintFileName: " << hist_name << std::endl;
+	f << "PrintPDF: FALSE" << std::endl;
+	f << "InteractiveMode: FALSE" << std::endl;
+
+	f.close();
+	return;
+}
@@ -31,13 +31,8 @@ void SFSpectrumIntegral::Draw( Option_t *option ){
 	TLine *lb = new TLine( m_lb, frame->GetY1(), m_lb, frame->GetY2() );
 	TLine *ub = new TLine( m_ub, frame->GetY1(), m_ub, frame->GetY2() );
 
-	double y1 = 0.0;
-	double y2 = 0.0;
-
-	for ( unsigned int i = 0; i <= this->GetBGPolyOrder(); ++i ){
-		y1 += this->GetBGPoly(i)*TMath::Power( m_lb, (int)i );
-		y2 += this->GetBGPoly(i)*TMath::Power( m_ub, (int)i );
-	}
+	double y1 = GetBackgroundAtX( m_lb );
+	double y2 = GetBackgroundAtX( m_ub );
 
 	TLine *bg = new TLine( m_lb, y1, m_ub, y2 );
 
@@ -60,78 +55,56 @@ void SFSpectrumIntegral::Draw( Option_t *option ){
 }
 ///////////////////////////////////////////////////////////////////////////////
 void SFSpectrumIntegral::CalculateIntegral(){
-	// Calculate the total integral and error
-	TH1F* h = m_parent_spectrum->GetHist();
-
-	// Find central portion
-	double integral = h->Integral( h->FindBin( m_lb ) + 1, h->FindBin( m_ub ) - 1 );
-	
-	// Add fractional quantities for end bins (linear scaling)
-	integral += h->GetBinContent( h->FindBin(m_lb ) )*( h->GetBinLowEdge( h->FindBin(m_lb) + 1 ) - m_lb )/h->GetBinWidth( h->FindBin(m_lb) );
-	integral += h->GetBinContent( h->FindBin(m_ub ) )*( m_ub - h->GetBinLowEdge( h->FindBin(m_ub) ) )/h->GetBinWidth( h->FindBin(m_ub) );
-
-	// Calculate background portion + centroid
+	// Total counts and their moments in the window, including the fractions of the end bins (linear scaling)
+	const SFSpectrum *spec = m_parent_spectrum;
+	const double integral = spec->GetCountsInRange( m_lb, m_ub );
+	const double sum_xy = spec->GetCountsInRange( m_lb, m_ub, 1 );
+	const double sum_xxy = spec->GetCountsInRange( m_lb, m_ub, 2 );
+
+	// Calculate the background portion, its contribution to the centroid and its
+	// derivatives with respect to the background parameters (for the error)
+	const unsigned int order = this->GetBGPolyOrder();
+	std::vector<double> bg_gradient( order + 1, 0.0 );
 	double bg_integral = 0.0;
-	double bg_error_squared = 0.0;
-	double sum_xy = 0.0;
-	double sum_y = 0.0;
-	double sum_xx = 0.0;
-	double sum_x = 0.0;
-	double sum_N = 0.0;
-
-	// Calculate the background contributions in the middle bins
-	for ( int i = h->FindBin( m_lb ); i <= h->FindBin( m_ub ); ++i ){
-		double x1 = TMath::Max( h->GetBinLowEdge(i), m_lb );
-		double x2 = TMath::Min( h->GetBinLowEdge(i+1), m_ub );
-		double y1 = 0.0;
-		double y2 = 0.0;
-		for ( unsigned int j = 0; j <= this->GetBGPolyOrder(); ++j ){
-			y1 += this->GetBGPoly(j)*TMath::Power( x1, (int)j );
-			y2 += this->GetBGPoly(j)*TMath::Power( x2, (int)j );
+	double bg_sum_x = 0.0;
+
+	const int first_bin = TMath::Max( spec->FindBin( m_lb ), 1 );
+	const int last_bin = TMath::Min( spec->FindBin( m_ub ), spec->GetNumberOfBins() );
+	const double *c = m_bg_value.data();
+	if ( first_bin <= last_bin )SFPolynomialDispatch( order, [&]( auto poly ){
+		double x1 = TMath::Max( spec->GetBinLowEdge( first_bin ), m_lb );
+		double y1 = poly.Value( c, x1, order );
+		for ( int i = first_bin; i <= last_bin; ++i ){
+			double x2 = TMath::Min( spec->GetBinUpEdge(i), m_ub );
+			double y2 = poly.Value( c, x2, order );
+			double bg_contribution = GetBackgroundInBin( poly, x1, x2, y1, y2, spec->GetBinContent(i), spec->GetBinWidth(i), bg_gradient.data() );
+			bg_integral += bg_contribution;
+			bg_sum_x += spec->GetBinCentre(i)*bg_contribution;
+
+			x1 = x2;
+			y1 = y2;
 		}
+	} );
 
-		// Now calculate the area based on the situation
-		double bg_contribution = 0.0;
-		double scale_bin_factor = (x2-x1)/h->GetBinWidth(0);
-		if ( y1 <=0  && y2<= 0 ){
-			// Line below histogram...
-			// Add no background
-		}
-		else if ( h->GetBinContent(i) < y1 && h->GetBinContent(i) < y2 ){
-			// Line above histogram...no centroid contribution
-			bg_contribution += h->GetBinContent(i)*scale_bin_factor;
-		}
-		else{
-			// Add this on to all options below here
-			bg_contribution += 0.5*(y1+y2)*scale_bin_factor;
-
-			// Check if we need to make a correction if the background passes through the top of the bin
-			if ( h->GetBinContent(i) > y1 && h->GetBinContent(i) <= y2 ){
-				double x3 = FindBackgroundXForGivenY( h->GetBinContent(i), h->GetBinCenter(i) );
-				bg_contribution -= 0.5*(x2-x3)*( y2 - h->GetBinContent(i) )/h->GetBinWidth(0);
-			}
-			else if ( h->GetBinContent(i) <= y1 && h->GetBinContent(i) > y2 ){
-				double x3 = FindBackgroundXForGivenY( h->GetBinContent(i), h->GetBinCenter(i) );
-				bg_contribution -= 0.5*(x3-x1)*( y1 - h->GetBinContent(i) )/h->GetBinWidth(0);
-			}
-		}
-		bg_integral += bg_contribution;
-
-		// Now work out centroid contribution (N.B. TODO bin center could be modified to improve this approximation...)
-		double weighted_y = ( h->GetBinContent(i) - bg_contribution );
-		if ( h->GetBinContent(i) > 0.0 )sum_N += weighted_y*scale_bin_factor/h->GetBinContent(i);
-		sum_x = h->GetBinCenter(i)*scale_bin_factor;
-		sum_xx = h->GetBinCenter(i)*h->GetBinCenter(i)*scale_bin_factor;
-		sum_y += weighted_y*scale_bin_factor;
-		sum_xy += h->GetBinCenter(i)*weighted_y*scale_bin_factor;
-	}
+	this->SetIntegralFromSums( integral, sum_xy, sum_xxy, bg_integral, bg_sum_x, bg_gradient );
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFSpectrumIntegral::SetIntegralFromSums( const double counts, const double sum_xy, const double sum_xxy, const double bg_integral, const double bg_sum_x, const std::vector<double> &bg_gradient ){
+	// A background drawn from coordinates has no errors of its own, so it is taken
+	// to be counts, with their Poisson error
+	double bg_error_squared = 0.0;
+	if ( m_background_from_coordinates )bg_error_squared = TMath::Abs( bg_integral );
+	else bg_error_squared = GetBackgroundVariance( bg_gradient );
 
 	// Set member variables
-	bg_error_squared = bg_integral;	// TODO NOT HAPPY WITH THIS, WILL NEED TO FIX LATER!!!
-	m_integral_value = integral - bg_integral;
-	m_integral_error = TMath::Sqrt( integral + bg_error_squared );
-	m_centroid = sum_xy/sum_y;
-	m_centroid_err = TMath::Sqrt( sum_xx - 2*sum_x*sum_xy/sum_y + sum_N*sum_xy*sum_xy/( sum_y*sum_y ) )/sum_y;
+	m_integral_value = counts - bg_integral;
+	m_integral_error = TMath::Sqrt( counts + bg_error_squared );
+
+	// Centroid of the counts above background, with Poisson errors on the counts
+	const double sum_y = counts - bg_integral;
+	m_centroid = ( sum_xy - bg_sum_x )/sum_y;
+	m_centroid_err = TMath::Sqrt( TMath::Max( sum_xxy - 2*m_centroid*sum_xy + m_centroid*m_centroid*counts, 0.0 ) )/TMath::Abs( sum_y );
 	return;
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -182,42 +155,83 @@ void SFSpectrumIntegral::SetBGCovMatrix( unsigned int i, unsigned int j, const d
 ///////////////////////////////////////////////////////////////////////////////
 double SFSpectrumIntegral::GetBackgroundAtX( const double x ) const{
 	double sum = 0.0;
-	for ( unsigned int i = 0; i <= this->GetBGPolyOrder(); ++i ){
-		sum += this->GetBGPoly(i)*TMath::Power( x, (int)i );
-	}
+	SFPolynomialDispatch( m_background_polynomial_level, [&]( auto poly ){
+		sum = poly.Value( m_bg_value.data(), x, m_background_polynomial_level );
+	} );
 	return sum;
 }
 ///////////////////////////////////////////////////////////////////////////////
 double SFSpectrumIntegral::GetBackgroundAtXError( const double x ) const{
+	std::vector<double> gradient( m_background_polynomial_level + 1 );
+	double xi = 1.0;
+	for ( unsigned int i = 0; i < gradient.size(); ++i ){
+		gradient[i] = xi;
+		xi *= x;
+	}
+	return TMath::Sqrt( GetBackgroundVariance( gradient ) );
+}
+///////////////////////////////////////////////////////////////////////////////
+// g^T V g for the covariance matrix V of the background parameters
+double SFSpectrumIntegral::GetBackgroundVariance( const std::vector<double> &gradient ) const{
 	double sum = 0.0;
-	for ( unsigned int i = 0; i <= this->GetBGPolyOrder(); ++i ){
-		sum += TMath::Power( TMath::Power( x, (int)i )*this->GetBGPolyErr(i), 2 );
+	for ( unsigned int i = 0; i < gradient.size() && i <= m_background_polynomial_level; ++i ){
+		sum += gradient[i]*gradient[i]*m_bg_err[i]*m_bg_err[i];
 		for ( unsigned int j = 0; j < i; ++j ){
-			sum += 2*TMath::Power( x, (int)(i+j) )*this->GetBGCovMatrix(i,j);
+			sum += 2*gradient[i]*gradient[j]*m_cov_matrix[i][j];
 		}
 	}
-	return TMath::Sqrt(sum);
+	return sum;
 }
 ///////////////////////////////////////////////////////////////////////////////
 double SFSpectrumIntegral::GetBackgroundDerivativeAtX( const double x ) const{
 	double sum = 0.0;
-	for ( unsigned int i = 1; i <= this->GetBGPolyOrder(); ++i ){
-		sum += i*this->GetBGPoly(i)*TMath::Power( x, (int)(i-1) );
-	}
+	SFPolynomialDispatch( m_background_polynomial_level, [&]( auto poly ){
+		sum = poly.Derivative( m_bg_value.data(), x, m_background_polynomial_level );
+	} );
 	return sum;
 }
 ///////////////////////////////////////////////////////////////////////////////
-double SFSpectrumIntegral::FindBackgroundXForGivenY( const double y, const double x_guess ) const{
-	double x1 = x_guess - 1;
-	double x2 = x_guess;
-	int count = 0;
-
-	while ( TMath::Abs( x2 - x1) < 1e-5 ){
-		x1 = x2;
-		x2 = x1 - ( GetBackgroundAtX(x1) - y )/GetBackgroundDerivativeAtX(x1);
-		count++;
+// The background must cross y between x1 and x2. Linear and quadratic backgrounds
+// are solved directly; higher orders use Newton's method, bisecting whenever a
+// step would leave the interval.
+double SFSpectrumIntegral::FindBackgroundXForGivenY( const double y, const double x1, const double x2 ) const{
+	const double *c = m_bg_value.data();
+	const unsigned int order = m_background_polynomial_level;
+	double lb = TMath::Min( x1, x2 );
+	double ub = TMath::Max( x1, x2 );
+
+	if ( order == 1 || ( order == 2 && c[2] == 0.0 ) ){
+		if ( c[1] != 0.0 )return TMath::Min( TMath::Max( ( y - c[0] )/c[1], lb ), ub );
+	}
+	else if ( order == 2 ){
+		// Roots of c2*x^2 + c1*x + (c0 - y), avoiding cancellation
+		double discriminant = c[1]*c[1] - 4*c[2]*( c[0] - y );
+		if ( discriminant >= 0.0 ){
+			double q = -0.5*( c[1] + ( c[1] < 0 ? -1 : 1 )*TMath::Sqrt( discriminant ) );
+			double root1 = q/c[2];
+			double root2 = ( q != 0.0 ? ( c[0] - y )/q : root1 );
+
+			// Take whichever is in (or nearest to) the interval
+			double clamped1 = TMath::Min( TMath::Max( root1, lb ), ub );
+			double clamped2 = TMath::Min( TMath::Max( root2, lb ), ub );
+			return ( TMath::Abs( root1 - clamped1 ) <= TMath::Abs( root2 - clamped2 ) ? clamped1 : clamped2 );
+		}
+	}
+
+	// Keep f(lb) and f(ub) on opposite sides of zero
+	const bool rising = ( GetBackgroundAtX( lb ) < y );
+	double x = 0.5*( lb + ub );
+	for ( int count = 0; count < 100 && ub - lb > 1e-10*TMath::Max( TMath::Abs(x), 1.0 ); ++count ){
+		double f = GetBackgroundAtX(x) - y;
+		if ( f == 0.0 )return x;
+		if ( ( f < 0.0 ) == rising )lb = x;
+		else ub = x;
+
+		double df = GetBackgroundDerivativeAtX(x);
+		double step = ( df != 0.0 ? x - f/df : lb );
+		x = ( step > lb && step < ub ? step : 0.5*( lb + ub ) );
 	}
-	return x2;
+	return x;
 }
 ///////////////////////////////////////////////////////////////////////////////
 TString SFSpectrumIntegral::GetStatus(){
@@ -0,0 +1,224 @@
+#include "SpectrumLoader.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFSpectrumLoader::SFSpectrumLoader(){
+	m_data_type = DataTypeUInt32;
+	m_big_endian = false;
+	m_header_size = 0;
+	m_number_of_bins = 0;
+	m_lb = 0.0;
+	m_bin_width = 1.0;
+	log->Construction("SFSpectrumLoader::SFSpectrumLoader -- SFSpectrumLoader object constructed");
+}
+///////////////////////////////////////////////////////////////////////////////
+SFSpectrumLoader::~SFSpectrumLoader(){
+	log->Construction("SFSpectrumLoader::~SFSpectrumLoader -- SFSpectrumLoader object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+bool SFSpectrumLoader::GetDataType( const TString &s, DataType &type ){
+	const char *names[] = { "int8", "uint8", "int16", "uint16", "int32", "uint32", "int64", "uint64", "float", "double" };
+	for ( unsigned int i = 0; i <= DataTypeDouble; ++i ){
+		if ( s == names[i] ){
+			type = (DataType)i;
+			return true;
+		}
+	}
+	return false;
+}
+///////////////////////////////////////////////////////////////////////////////
+unsigned int SFSpectrumLoader::GetDataSize( const DataType type ){
+	const unsigned int sizes[] = { 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 };
+	return sizes[type];
+}
+///////////////////////////////////////////////////////////////////////////////
+bool SFSpectrumLoader::IsSwapped() const {
+	const uint16_t one = 1;
+	return ( m_big_endian == ( *(const unsigned char*)&one == 1 ) );
+}
+///////////////////////////////////////////////////////////////////////////////
+// The type SFBinView reads the numbers as, if they can be read as they are in the file
+bool SFSpectrumLoader::GetContentType( SFBinView::ContentType &type ) const {
+	if ( IsSwapped() && GetDataSize( m_data_type ) > 1 )return false;
+	if ( m_header_size%GetDataSize( m_data_type ) != 0 )return false;
+	switch ( m_data_type ){
+		case DataTypeInt8: type = SFBinView::ContentChar; return std::numeric_limits<char>::is_signed;
+		case DataTypeUInt8: type = SFBinView::ContentUChar; return true;
+		case DataTypeInt16: type = SFBinView::ContentShort; return ( sizeof(short) == 2 );
+		case DataTypeUInt16: type = SFBinView::ContentUShort; return ( sizeof(unsigned short) == 2 );
+		case DataTypeInt32: type = SFBinView::ContentInt; return ( sizeof(int) == 4 );
+		case DataTypeUInt32: type = SFBinView::ContentUInt; return ( sizeof(unsigned int) == 4 );
+		case DataTypeFloat: type = SFBinView::ContentFloat; return true;
+		case DataTypeDouble: type = SFBinView::ContentDouble; return true;
+		default: return false;
+	}
+}
+///////////////////////////////////////////////////////////////////////////////
+bool SFSpectrumLoader::ReadBinary( const TString &file_name, SFBinView &view ) const {
+	int fd = open( file_name.Data(), O_RDONLY );
+	if ( fd < 0 ){
+		log->Warning( Form( "SFSpectrumLoader::ReadBinary -- Could not open %s (%s)", file_name.Data(), std::strerror(errno) ) );
+		return false;
+	}
+
+	struct stat info;
+	if ( fstat( fd, &info ) != 0 || info.st_size <= 0 || (unsigned long)info.st_size <= m_header_size ){
+		log->Warning( Form( "SFSpectrumLoader::ReadBinary -- %s has no data after a header of %lu bytes", file_name.Data(), m_header_size ) );
+		close(fd);
+		return false;
+	}
+
+	// Check that the bins fit in the file
+	const unsigned int size = GetDataSize( m_data_type );
+	const unsigned long available = ( info.st_size - m_header_size )/size;
+	unsigned long n = ( m_number_of_bins > 0 ? m_number_of_bins : available );
+	if ( n == 0 ){
+		log->Warning( Form( "SFSpectrumLoader::ReadBinary -- %s does not hold a whole bin after a header of %lu bytes", file_name.Data(), m_header_size ) );
+		close(fd);
+		return false;
+	}
+	if ( n > available ){
+		log->Warning( Form( "SFSpectrumLoader::ReadBinary -- %s has room for %lu bins, not %lu", file_name.Data(), available, n ) );
+		close(fd);
+		return false;
+	}
+	if ( n > (unsigned long)std::numeric_limits<int>::max() - 2 ){
+		log->Warning( Form( "SFSpectrumLoader::ReadBinary -- %s has too many bins (%lu)", file_name.Data(), n ) );
+		close(fd);
+		return false;
+	}
+	if ( m_number_of_bins == 0 && ( info.st_size - m_header_size )%size != 0 ){
+		log->Warning( Form( "SFSpectrumLoader::ReadBinary -- %s does not hold a whole number of bins. Ignoring the last %lu bytes", file_name.Data(), ( info.st_size - m_header_size )%size ) );
+	}
+
+	void *map = mmap( nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close(fd);
+	if ( map == MAP_FAILED ){
+		log->Warning( Form( "SFSpectrumLoader::ReadBinary -- Could not map %s (%s)", file_name.Data(), std::strerror(errno) ) );
+		return false;
+	}
+	std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>();
+	buffer->map = map;
+	buffer->map_size = info.st_size;
+
+	buffer->edges.resize( n + 1 );
+	for ( unsigned long i = 0; i <= n; ++i ){
+		buffer->edges[i] = m_lb + i*m_bin_width;
+	}
+
+	// View the numbers where they are if possible, otherwise convert them and let the mapping go
+	const unsigned char *data = (const unsigned char*)map + m_header_size;
+	SFBinView::ContentType type;
+	if ( GetContentType( type ) ){
+		madvise( map, info.st_size, MADV_WILLNEED );
+		view = SFBinView( n, buffer->edges.data(), data, type );
+		log->Debug( Form( "SFSpectrumLoader::ReadBinary -- Mapped %lu bins from %s", n, file_name.Data() ) );
+	}
+	else{
+		madvise( map, info.st_size, MADV_SEQUENTIAL );
+		switch ( m_data_type ){
+			case DataTypeInt8: ConvertValues<int8_t>( data, n, buffer->contents ); break;
+			case DataTypeUInt8: ConvertValues<uint8_t>( data, n, buffer->contents ); break;
+			case DataTypeInt16: ConvertValues<int16_t>( data, n, buffer->contents ); break;
+			case DataTypeUInt16: ConvertValues<uint16_t>( data, n, buffer->contents ); break;
+			case DataTypeInt32: ConvertValues<int32_t>( data, n, buffer->contents ); break;
+			case DataTypeUInt32: ConvertValues<uint32_t>( data, n, buffer->contents ); break;
+			case DataTypeInt64: ConvertValues<int64_t>( data, n, buffer->contents ); break;
+			case DataTypeUInt64: ConvertValues<uint64_t>( data, n, buffer->contents ); break;
+			case DataTypeFloat: ConvertValues<float>( data, n, buffer->contents ); break;
+			case DataTypeDouble: ConvertValues<double>( data, n, buffer->contents ); break;
+		}
+		munmap( map, info.st_size );
+		buffer->map = nullptr;
+		view = SFBinView( n, buffer->edges.data(), buffer->contents.data(), SFBinView::ContentDouble );
+		log->Debug( Form( "SFSpectrumLoader::ReadBinary -- Read %lu bins from %s", n, file_name.Data() ) );
+	}
+	view.SetSource( buffer );
+	return true;
+}
+///////////////////////////////////////////////////////////////////////////////
+bool SFSpectrumLoader::ReadASCII( const TString &file_name, SFBinView &view ) const {
+	std::ifstream input( file_name.Data() );
+	if ( !input.is_open() ){
+		log->Warning( Form( "SFSpectrumLoader::ReadASCII -- Could not open %s", file_name.Data() ) );
+		return false;
+	}
+
+	std::vector<double> x;
+	std::vector<double> contents;
+	int columns = 0;
+	unsigned long line_number = 0;
+	std::string line;
+	while ( std::getline( input, line ) ){
+		line_number++;
+		const char *p = line.c_str();
+		while ( *p == ' ' || *p == '\t' )++p;
+		if ( *p == '\0' || *p == '#' || *p == '\r' )continue;
+
+		// Up to two numbers separated by spaces, tabs or commas
+		double values[2];
+		int n = 0;
+		char *end = nullptr;
+		while ( n < 2 ){
+			values[n] = std::strtod( p, &end );
+			if ( end == p )break;
+			n++;
+			p = end;
+			while ( *p == ' ' || *p == '\t' || *p == ',' )++p;
+		}
+
+		// A line of column names can come first
+		if ( n == 0 ){
+			if ( contents.size() == 0 )continue;
+			log->Warning( Form( "SFSpectrumLoader::ReadASCII -- Could not read line %lu of %s", line_number, file_name.Data() ) );
+			return false;
+		}
+		if ( columns == 0 )columns = n;
+		if ( n != columns ){
+			log->Warning( Form( "SFSpectrumLoader::ReadASCII -- Line %lu of %s has %d column(s) rather than %d", line_number, file_name.Data(), n, columns ) );
+			return false;
+		}
+
+		if ( n == 2 ){
+			x.push_back( values[0] );
+			contents.push_back( values[1] );
+		}
+		else contents.push_back( values[0] );
+	}
+
+	if ( contents.size() == 0 ){
+		log->Warning( Form( "SFSpectrumLoader::ReadASCII -- No bins in %s", file_name.Data() ) );
+		return false;
+	}
+
+	// Bin edges halfway between the x values, with the end bins as wide as their neighbours
+	std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>();
+	const unsigned long n = contents.size();
+	std::vector<double> &edges = buffer->edges;
+	edges.resize( n + 1 );
+	if ( x.size() == 0 ){
+		for ( unsigned long i = 0; i <= n; ++i ){
+			edges[i] = m_lb + i*m_bin_width;
+		}
+	}
+	else if ( x.size() == 1 ){
+		edges[0] = x[0] - 0.5*m_bin_width;
+		edges[1] = x[0] + 0.5*m_bin_width;
+	}
+	else{
+		for ( unsigned long i = 1; i < n; ++i ){
+			if ( x[i] <= x[i-1] ){
+				log->Warning( Form( "SFSpectrumLoader::ReadASCII -- The x values in %s must increase (%g follows %g)", file_name.Data(), x[i], x[i-1] ) );
+				return false;
+			}
+			edges[i] = 0.5*( x[i-1] + x[i] );
+		}
+		edges[0] = x[0] - 0.5*( x[1] - x[0] );
+		edges[n] = x[n-1] + 0.5*( x[n-1] - x[n-2] );
+	}
+
+	buffer->contents.swap( contents );
+	view = SFBinView( n, edges.data(), buffer->contents.data(), SFBinView::ContentDouble );
+	view.SetSource( buffer );
+	log->Debug( Form( "SFSpectrumLoader::ReadASCII -- Read %lu bins from %s", n, file_name.Data() ) );
+	return true;
+}
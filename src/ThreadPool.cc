@@ -0,0 +1,50 @@
+#include "ThreadPool.hh"
+
+///////////////////////////////////////////////////////////////////////////////
+SFThreadPool::SFThreadPool( const unsigned int number_of_threads ){
+	m_number_of_threads = number_of_threads;
+
+	// Zero means use every core on the machine
+	if ( m_number_of_threads == 0 ){
+		m_number_of_threads = TMath::Max( std::thread::hardware_concurrency(), 1u );
+	}
+	log->Construction( Form( "SFThreadPool::SFThreadPool -- SFThreadPool object constructed with %u threads", m_number_of_threads ) );
+}
+///////////////////////////////////////////////////////////////////////////////
+SFThreadPool::~SFThreadPool(){
+	log->Construction("SFThreadPool::~SFThreadPool -- SFThreadPool object destroyed");
+}
+///////////////////////////////////////////////////////////////////////////////
+void SFThreadPool::Execute( const unsigned int number_of_tasks, const std::function<void(unsigned int)> &task ) const {
+	// Nothing to gain from threads here
+	unsigned int number_of_workers = TMath::Min( m_number_of_threads, number_of_tasks );
+	if ( number_of_workers <= 1 ){
+		for ( unsigned int i = 0; i < number_of_tasks; ++i ){
+			task(i);
+		}
+		return;
+	}
+
+	// Each worker takes the next task that nobody has started yet
+	std::atomic<unsigned int> next_task( 0 );
+	auto worker = [&](){
+		for ( unsigned int i = next_task++; i < number_of_tasks; i = next_task++ ){
+			task(i);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve( number_of_workers - 1 );
+	for ( unsigned int i = 1; i < number_of_workers; ++i ){
+		workers.emplace_back( worker );
+	}
+
+	// The calling thread does its share too
+	worker();
+	for ( unsigned int i = 0; i < workers.size(); ++i ){
+		workers.at(i).join();
+	}
+
+	log->Debug( Form( "SFThreadPool::Execute -- Completed %u tasks on %u threads", number_of_tasks, number_of_workers ) );
+	return;
+}
@@ -0,0 +1,512 @@
+// Runs spectrum_fitter on the spectra listed in test/corpus.dat and checks that
+//	* the fitted means and widths agree with the true values, from the
+//	  generator or, for the fixed spectra in test/spectra/, test/golden/
+//	* the fitted peaks and backgrounds match the results recorded in test/golden/
+//	* no stage takes longer, and the process uses no more memory, than the
+//	  budgets in test/budgets.dat allow
+// Run with "make test". "make test_record" accepts the current results as the
+// new recorded results and budgets, for the cases that agree with the true
+// values -- the budgets belong to the machine they were recorded on. A case with
+// no recorded results or budgets fails, unless --allow-missing is given, which
+// skips those checks with a note. Exits with 1 if anything fails.
+#include "CommandLineInterface.hh"
+#include "FitReader.hh"
+#include "MessageLogger.hh"
+#include "SpectrumGenerator.hh"
+
+#include <TEnv.h>
+#include <TFile.h>
+#include <TH1D.h>
+#include <TMath.h>
+#include <TObjArray.h>
+#include <TObjString.h>
+#include <TString.h>
+#include <TSystem.h>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+MessageLogger* MessageLogger::m_instance_ptr = nullptr;
+
+// Limits on the differences (see test/corpus.dat)
+struct Tolerances{
+	double value;		// Change of a value, in units of its golden error
+	double error;		// Relative change of an error
+	double truth;		// Distance of a mean or width from the true value, in units of its error
+	double margin;		// Relative amount a time or the memory can exceed its budget by
+	double min_time;	// Time differences below this (s) are ignored
+};
+
+// True parameters of the peaks in a spectrum
+struct Truth{
+	std::vector<double> mean, width;
+};
+
+// What one run of spectrum_fitter took
+struct RunUsage{
+	std::map<std::string,double> stage_time;	// Top-level timers of --profile, s
+	double total_time;							// s
+	long max_rss;								// kB
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Run spectrum_fitter in dir, recording its peak memory use
+bool RunFitter( const TString &fitter, const TString &dir, const TString &config, const TString &profile, RunUsage &usage ){
+	auto start = std::chrono::steady_clock::now();
+	pid_t pid = fork();
+	if ( pid < 0 )return false;
+	if ( pid == 0 ){
+		if ( chdir( dir.Data() ) != 0 )_exit(127);
+		execl( fitter.Data(), fitter.Data(), "-s", config.Data(), "--profile", profile.Data(), (char*)nullptr );
+		_exit(127);
+	}
+
+	int status = 0;
+	struct rusage r;
+	if ( wait4( pid, &status, 0, &r ) != pid )return false;
+	usage.total_time = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+#ifdef MACOSX
+	usage.max_rss = r.ru_maxrss/1024;	// bytes on macOS
+#else
+	usage.max_rss = r.ru_maxrss;
+#endif
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+// The top-level timers written by SFProfiler::WriteJSON, one per line
+void ReadProfile( const TString &file_name, RunUsage &usage ){
+	std::ifstream f( file_name.Data() );
+	std::string line;
+	const TString name_key = "\t\t{ \"name\": \"";
+	while ( std::getline( f, line ) ){
+		TString s = line.c_str();
+		if ( !s.BeginsWith( name_key ) )continue;
+		TString rest = s( name_key.Length(), s.Length() - name_key.Length() );
+		TString name = rest( 0, rest.Index("\"") );
+		Ssiz_t wall = rest.Index("\"wall_s\": ");
+		if ( wall == kNPOS )continue;
+		usage.stage_time[ name.Data() ] += TString( rest( wall + 10, rest.Length() - wall - 10 ) ).Atof();
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Options are given as "Key: value; Key: value". Each replaces any line of the
+// config file with the same key, and a key with no value is removed.
+void OverrideOptions( const TString &file_name, const TString &options ){
+	std::map<std::string,TString> overrides;
+	std::vector<std::string> keys;
+	TObjArray *list = options.Tokenize(";");
+	for ( int i = 0; i < list->GetEntries(); ++i ){
+		TString option = ( (TObjString*)list->At(i) )->GetString();
+		Ssiz_t colon = option.Index(":");
+		if ( colon == kNPOS )continue;
+		TString key = option( 0, colon );
+		TString value = option( colon + 1, option.Length() - colon - 1 );
+		key = key.Strip( TString::kBoth );
+		value = value.Strip( TString::kBoth );
+		if ( overrides.count( key.Data() ) == 0 )keys.push_back( key.Data() );
+		overrides[ key.Data() ] = value;
+	}
+	delete list;
+	if ( overrides.size() == 0 )return;
+
+	std::vector<std::string> lines;
+	std::ifstream in( file_name.Data() );
+	std::string line;
+	while ( std::getline( in, line ) ){
+		TString s = line.c_str();
+		Ssiz_t colon = s.Index(":");
+		TString key = ( colon == kNPOS ? TString("") : TString( s( 0, colon ) ).Strip( TString::kBoth ) );
+		if ( !s.BeginsWith("#") && overrides.count( key.Data() ) > 0 )continue;
+		lines.push_back( line );
+	}
+	in.close();
+
+	std::ofstream out( file_name.Data() );
+	for ( unsigned int i = 0; i < lines.size(); ++i ){
+		out << lines.at(i) << std::endl;
+	}
+	out << "# OPTIONS FROM corpus.dat" << std::endl;
+	for ( unsigned int i = 0; i < keys.size(); ++i ){
+		if ( overrides[ keys.at(i) ] != "" )out << keys.at(i) << ": " << overrides[ keys.at(i) ] << std::endl;
+	}
+	out.close();
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// NumberOfPeaks and NN.Mean, NN.Width for each peak
+bool ReadTruth( const TString &file_name, Truth &truth ){
+	if ( gSystem->AccessPathName( file_name ) )return false;
+	TEnv *env = new TEnv( file_name );
+	int number_of_peaks = env->GetValue( "NumberOfPeaks", 0 );
+	for ( int i = 0; i < number_of_peaks; ++i ){
+		truth.mean.push_back( env->GetValue( Form( "%02d.Mean", i ), 0.0 ) );
+		truth.width.push_back( env->GetValue( Form( "%02d.Width", i ), 0.0 ) );
+	}
+	delete env;
+	return ( number_of_peaks > 0 );
+}
+///////////////////////////////////////////////////////////////////////////////
+// The bin contents as little-endian uint32, whatever the machine
+void WriteRaw( const TH1 *h, const TString &file_name ){
+	std::ofstream f( file_name.Data(), std::ios::binary );
+	for ( int i = 1; i <= h->GetNbinsX(); ++i ){
+		unsigned int n = (unsigned int)TMath::Nint( h->GetBinContent(i) );
+		char bytes[4] = { (char)( n & 0xff ), (char)( ( n >> 8 ) & 0xff ), (char)( ( n >> 16 ) & 0xff ), (char)( ( n >> 24 ) & 0xff ) };
+		f.write( bytes, 4 );
+	}
+	f.close();
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// value within tolerance*error of golden (errors of 0, e.g. fixed values, must match)
+bool CheckValue( const TString &what, const double value, const double golden, const double golden_err, const double tolerance, std::vector<TString> &failures ){
+	double allowed = TMath::Max( tolerance*golden_err, 1e-9*TMath::Abs( golden ) );
+	if ( TMath::Abs( value - golden ) > allowed ){
+		failures.push_back( Form( "%s is %g, golden %g +/- %g", what.Data(), value, golden, golden_err ) );
+		return false;
+	}
+	return true;
+}
+///////////////////////////////////////////////////////////////////////////////
+void CompareWithGolden( const SFFitReader::SpectrumResult &result, const SFFitReader::SpectrumResult &golden, const Tolerances &tol, std::vector<TString> &failures ){
+	if ( result.peaks.size() != golden.peaks.size() || result.fits.size() != golden.fits.size() ){
+		failures.push_back( Form( "%lu peaks and %lu fits, golden %lu and %lu", result.peaks.size(), result.fits.size(), golden.peaks.size(), golden.fits.size() ) );
+		return;
+	}
+
+	for ( unsigned int i = 0; i < golden.peaks.size(); ++i ){
+		const SFFitReader::PeakResult &p = result.peaks.at(i);
+		const SFFitReader::PeakResult &g = golden.peaks.at(i);
+		CheckValue( Form( "P.%02d mean", i ), p.mean, g.mean, g.mean_err, tol.value, failures );
+		CheckValue( Form( "P.%02d width", i ), p.width, g.width, g.width_err, tol.value, failures );
+		CheckValue( Form( "P.%02d amplitude", i ), p.amplitude, g.amplitude, g.amplitude_err, tol.value, failures );
+		CheckValue( Form( "P.%02d mean error", i ), p.mean_err, g.mean_err, g.mean_err, tol.error, failures );
+		CheckValue( Form( "P.%02d width error", i ), p.width_err, g.width_err, g.width_err, tol.error, failures );
+		CheckValue( Form( "P.%02d amplitude error", i ), p.amplitude_err, g.amplitude_err, g.amplitude_err, tol.error, failures );
+	}
+
+	for ( unsigned int i = 0; i < golden.fits.size(); ++i ){
+		const SFFitReader::BackgroundResult &b = result.fits.at(i);
+		const SFFitReader::BackgroundResult &g = golden.fits.at(i);
+		if ( b.is_valid != g.is_valid ){
+			failures.push_back( Form( "Fit %u is %s, golden %s", i, b.is_valid ? "valid" : "invalid", g.is_valid ? "valid" : "invalid" ) );
+		}
+		if ( b.bg.size() != g.bg.size() ){
+			failures.push_back( Form( "Fit %u has %lu background terms, golden %lu", i, b.bg.size(), g.bg.size() ) );
+			continue;
+		}
+		for ( unsigned int j = 0; j < g.bg.size(); ++j ){
+			CheckValue( Form( "Fit %u background %u", i, j ), b.bg.at(j), g.bg.at(j), g.bg_err.at(j), tol.value, failures );
+			CheckValue( Form( "Fit %u background %u error", i, j ), b.bg_err.at(j), g.bg_err.at(j), g.bg_err.at(j), tol.error, failures );
+		}
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+void CompareWithTruth( const SFFitReader::SpectrumResult &result, const Truth &truth, const Tolerances &tol, std::vector<TString> &failures ){
+	if ( result.peaks.size() != truth.mean.size() ){
+		failures.push_back( Form( "%lu peaks fitted, %lu true", result.peaks.size(), truth.mean.size() ) );
+		return;
+	}
+	for ( unsigned int i = 0; i < truth.mean.size(); ++i ){
+		const SFFitReader::PeakResult &p = result.peaks.at(i);
+		if ( !( p.mean_err > 0 ) || TMath::Abs( p.mean - truth.mean.at(i) ) > tol.truth*p.mean_err ){
+			failures.push_back( Form( "P.%02d mean is %g +/- %g, true value %g", i, p.mean, p.mean_err, truth.mean.at(i) ) );
+		}
+		if ( !( p.width_err > 0 ) || TMath::Abs( p.width - truth.width.at(i) ) > tol.truth*p.width_err ){
+			failures.push_back( Form( "P.%02d width is %g +/- %g, true value %g", i, p.width, p.width_err, truth.width.at(i) ) );
+		}
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// A missing budget goes to missing, to be failed or noted by the caller
+void CompareWithBudget( const TString &name, const RunUsage &usage, TEnv *budgets, const Tolerances &tol, std::vector<TString> &failures, std::vector<TString> &missing ){
+	std::map<std::string,double> times = usage.stage_time;
+	times["Total"] = usage.total_time;
+	for ( std::map<std::string,double>::const_iterator it = times.begin(); it != times.end(); ++it ){
+		double budget = budgets->GetValue( Form( "%s.Time.%s", name.Data(), it->first.c_str() ), -1.0 );
+		if ( budget < 0 ){
+			missing.push_back( Form( "No time budget for %s", it->first.c_str() ) );
+		}
+		else if ( it->second > ( 1.0 + tol.margin )*budget && it->second - budget > tol.min_time ){
+			failures.push_back( Form( "%s took %.3f s, budget %.3f s", it->first.c_str(), it->second, budget ) );
+		}
+	}
+
+	long budget = budgets->GetValue( Form( "%s.MaxRSS", name.Data() ), -1 );
+	if ( budget < 0 ){
+		missing.push_back("No memory budget");
+	}
+	else if ( usage.max_rss > ( 1.0 + tol.margin )*budget ){
+		failures.push_back( Form( "Used %ld kB, budget %ld kB", usage.max_rss, budget ) );
+	}
+	return;
+}
+///////////////////////////////////////////////////////////////////////////////
+// Writes the spectra of case i and its config file (name.dat) to the work
+// directory, and returns the names of the histograms and their true peaks. A
+// case with a Config is a fixed spectrum in test/spectra/, with its true values
+// in test/golden/name_truth.dat; otherwise SFSpectrumGenerator makes Spectra
+// histograms with the same peaks, in a ROOT file or one raw file each.
+bool MakeCase( TEnv *corpus, const int i, const TString &name, const TString &test_dir, const TString &work_dir, Truth &truth, std::vector<TString> &spectra, std::vector<TString> &failures ){
+	TString config_file = work_dir + "/" + name + ".dat";
+	TString fixed_config = corpus->GetValue( Form( "%02d.Config", i ), "" );
+	TString options = corpus->GetValue( Form( "%02d.Options", i ), "" );
+
+	if ( fixed_config != "" ){
+		TString truth_file = test_dir + "/golden/" + name + "_truth.dat";
+		if ( gSystem->CopyFile( test_dir + "/" + fixed_config, config_file, true ) != 0 ){
+			failures.push_back( Form( "Cannot copy %s/%s", test_dir.Data(), fixed_config.Data() ) );
+			return false;
+		}
+		if ( !ReadTruth( truth_file, truth ) ){
+			failures.push_back( Form( "No true values in %s", truth_file.Data() ) );
+			return false;
+		}
+		spectra.push_back( name );
+		OverrideOptions( config_file, options );
+		return true;
+	}
+
+	SFSpectrumGenerator::WidthModel width_model = SFSpectrumGenerator::WidthConstant;
+	SFSpectrumGenerator::BackgroundShape background_shape = SFSpectrumGenerator::BackgroundFlat;
+	SFSpectrumGenerator::GetWidthModel( corpus->GetValue( Form( "%02d.WidthModel", i ), "const" ), width_model );
+	SFSpectrumGenerator::GetBackgroundShape( corpus->GetValue( Form( "%02d.Background", i ), "flat" ), background_shape );
+
+	SFSpectrumGenerator sg;
+	sg.SetNumberOfPeaks( corpus->GetValue( Form( "%02d.Peaks", i ), 10 ) );
+	sg.SetNumberOfBins( corpus->GetValue( Form( "%02d.Bins", i ), 1000 ) );
+	sg.SetRange( corpus->GetValue( Form( "%02d.LB", i ), 1000.0 ), corpus->GetValue( Form( "%02d.UB", i ), 2000.0 ) );
+	sg.SetCounts( corpus->GetValue( Form( "%02d.Counts", i ), 1e5 ) );
+	sg.SetBackgroundFraction( corpus->GetValue( Form( "%02d.BackgroundFraction", i ), 0.2 ) );
+	sg.SetWidth( corpus->GetValue( Form( "%02d.Width", i ), -1.0 ) );
+	sg.SetWidthModel( width_model );
+	sg.SetBackgroundShape( background_shape );
+	sg.SetSeed( corpus->GetValue( Form( "%02d.Seed", i ), 1 ) );
+	sg.GeneratePeaks();
+	for ( unsigned int j = 0; j < sg.GetNumberOfPeaks(); ++j ){
+		truth.mean.push_back( sg.GetPeakMean(j) );
+		truth.width.push_back( sg.GetPeakWidth(j) );
+	}
+
+	int number_of_spectra = TMath::Max( corpus->GetValue( Form( "%02d.Spectra", i ), 1 ), 1 );
+	TString input = corpus->GetValue( Form( "%02d.Input", i ), "root" );
+	input.ToLower();
+	if ( input != "root" && input != "raw" ){
+		failures.push_back( Form( "Input must be root or raw, not %s", input.Data() ) );
+		return false;
+	}
+
+	TFile *f = ( input == "root" ? new TFile( work_dir + "/" + name + ".root", "RECREATE" ) : nullptr );
+	for ( int k = 0; k < number_of_spectra; ++k ){
+		TString hist_name = ( number_of_spectra > 1 ? Form( "%s_%d", name.Data(), k ) : name.Data() );
+		TH1D *h = sg.GenerateHistogram( hist_name, k );
+		if ( f != nullptr )h->Write();
+		else WriteRaw( h, work_dir + "/" + hist_name + ".raw" );
+		delete h;
+		spectra.push_back( hist_name );
+	}
+	if ( f != nullptr ){
+		f->Close();
+		delete f;
+	}
+
+	// Written for a single histogram, then pointed at all of them
+	sg.WriteConfigFile( config_file, name + ".root", name );
+	TString inputs = "";
+	if ( input == "raw" ){
+		double lb = corpus->GetValue( Form( "%02d.LB", i ), 1000.0 );
+		double bin_width = ( corpus->GetValue( Form( "%02d.UB", i ), 2000.0 ) - lb )/corpus->GetValue( Form( "%02d.Bins", i ), 1000 );
+		TString raw_files = ( number_of_spectra > 1 ? name + "_*.raw" : name + ".raw" );
+		inputs = Form( "ROOTFile: ; ROOTHistName: ; RawFile: %s; RawDataType: uint32; RawByteOrder: little; SpectrumLB: %.10g; SpectrumBinWidth: %.10g; ", raw_files.Data(), lb, bin_width );
+	}
+	else if ( number_of_spectra > 1 ){
+		inputs = Form( "ROOTHistName: %s_*; ", name.Data() );
+	}
+	OverrideOptions( config_file, inputs + options );
+	return true;
+}
+///////////////////////////////////////////////////////////////////////////////
+int main( int argc, char *argv[] ){
+	MessageLogger *log = MessageLogger::GetInstance();
+	log->SetPrintConsoleLevel( MessageLogger::LevelWarning );
+
+	// Options
+	TString fitter_location = "./bin/spectrum_fitter";
+	TString test_dir = "./test";
+	TString s_margin = "0.5";
+	bool record = false;
+	bool allow_missing = false;
+	bool debug = false;
+	bool help = false;
+
+	CommandLineInterface *interface = new CommandLineInterface();
+	interface->Add( "-f", "spectrum_fitter to test", &fitter_location );
+	interface->Add( "-t", "Directory with corpus.dat, budgets.dat and golden/", &test_dir );
+	interface->Add( "--margin", "Fraction a time or the memory can exceed its budget by", &s_margin );
+	interface->Add( "--record", "Save the results that agree with the true values as the new goldens and budgets", &record );
+	interface->Add( "--allow-missing", "Skip, rather than fail, the checks that have no recorded results or budgets", &allow_missing );
+	interface->Add( "-d", "Print debug messages when running", &debug );
+	interface->Add( "-h", "Print this help", &help );
+	interface->CheckFlags( argc, argv );
+	if ( help ){
+		interface->CheckFlags( 1, argv );
+		delete interface;
+		delete log;
+		return 0;
+	}
+	if ( debug ){
+		log->SetPrintConsoleLevel( MessageLogger::LevelDebug );
+	}
+
+	// The fitter is run from the work directory
+	char path[PATH_MAX];
+	if ( realpath( fitter_location.Data(), path ) == nullptr ){
+		log->Error( Form( "Cannot find spectrum_fitter at %s", fitter_location.Data() ) );
+	}
+	TString fitter = path;
+	TString work_dir = test_dir + "/work";
+	TString golden_dir = test_dir + "/golden";
+	TString budget_file = test_dir + "/budgets.dat";
+	gSystem->mkdir( work_dir, true );
+	gSystem->mkdir( golden_dir, true );
+
+	TEnv *corpus = new TEnv( test_dir + "/corpus.dat" );
+	int number_of_cases = corpus->GetValue( "NumberOfCases", 0 );
+	Tolerances tol;
+	tol.value = corpus->GetValue( "Tolerance", 0.1 );
+	tol.error = corpus->GetValue( "ErrorTolerance", 0.05 );
+	tol.truth = corpus->GetValue( "TruthPulls", 5.0 );
+	tol.min_time = corpus->GetValue( "MinimumTime", 0.05 );
+	tol.margin = s_margin.Atof();
+
+	bool have_budgets = !gSystem->AccessPathName( budget_file );
+	TEnv *budgets = new TEnv( have_budgets ? budget_file.Data() : "" );
+	std::ofstream new_budgets;
+	if ( record ){
+		new_budgets.open( budget_file.Data() );
+		new_budgets << "# Written by \"make test_record\" -- times in s, memory in kB" << std::endl;
+	}
+
+	int number_failed = 0;
+	for ( int i = 0; i < number_of_cases; ++i ){
+		TString name = corpus->GetValue( Form( "%02d.Name", i ), Form( "case%02d", i ) );
+		std::vector<TString> failures;
+		std::vector<TString> notes;
+		std::vector<TString> missing;
+
+		// Make the spectra and the config file
+		Truth truth;
+		std::vector<TString> spectra;
+		if ( !MakeCase( corpus, i, name, test_dir, work_dir, truth, spectra, failures ) ){
+			std::cout << name << ": FAILED (" << failures.at(0) << ")" << std::endl;
+			number_failed++;
+			continue;
+		}
+
+		// Fit them. A warm-started case is fitted twice, and the second fit is checked
+		TString result_file = work_dir + "/" + name + "_fit_parameters.dat";
+		RunUsage usage;
+		bool ran = true;
+		if ( corpus->GetValue( Form( "%02d.WarmStart", i ), false ) ){
+			TString previous_file = name + "_previous_fit_parameters.dat";
+			gSystem->Unlink( result_file );
+			ran = RunFitter( fitter, work_dir, name + ".dat", name + "_profile.json", usage ) && !gSystem->AccessPathName( result_file );
+			ran = ran && gSystem->Rename( result_file, work_dir + "/" + previous_file ) == 0;
+			OverrideOptions( work_dir + "/" + name + ".dat", "WarmStartFile: " + previous_file );
+		}
+		gSystem->Unlink( result_file );
+		if ( !ran || !RunFitter( fitter, work_dir, name + ".dat", name + "_profile.json", usage ) || gSystem->AccessPathName( result_file ) ){
+			std::cout << name << ": FAILED (spectrum_fitter did not run to the end)" << std::endl;
+			number_failed++;
+			continue;
+		}
+		ReadProfile( work_dir + "/" + name + "_profile.json", usage );
+
+		SFFitReader reader;
+		reader.ReadFile( result_file );
+		if ( reader.GetNumberOfSpectra() != spectra.size() ){
+			failures.push_back( Form( "%u spectra fitted, %lu expected", reader.GetNumberOfSpectra(), spectra.size() ) );
+		}
+
+		// The physics does not depend on the machine, so it is always checked
+		TString golden_file = golden_dir + "/" + name + ".dat";
+		bool have_golden = !gSystem->AccessPathName( golden_file );
+		SFFitReader golden_reader;
+		if ( have_golden && !record )golden_reader.ReadFile( golden_file );
+		else if ( !record )missing.push_back( Form( "No recorded results in %s (make test_record)", golden_file.Data() ) );
+
+		for ( unsigned int k = 0; k < spectra.size(); ++k ){
+			std::vector<TString> spectrum_failures;
+			const SFFitReader::SpectrumResult *result = reader.GetSpectrumResult( spectra.at(k) );
+			if ( result == nullptr ){
+				spectrum_failures.push_back( Form( "No results in %s", result_file.Data() ) );
+			}
+			else{
+				CompareWithTruth( *result, truth, tol, spectrum_failures );
+				if ( have_golden && !record ){
+					const SFFitReader::SpectrumResult *golden = golden_reader.GetSpectrumResult( spectra.at(k) );
+					if ( golden == nullptr )spectrum_failures.push_back( Form( "No results in %s", golden_file.Data() ) );
+					else CompareWithGolden( *result, *golden, tol, spectrum_failures );
+				}
+			}
+			for ( unsigned int j = 0; j < spectrum_failures.size(); ++j ){
+				failures.push_back( ( spectra.size() > 1 ? spectra.at(k) + ": " : TString("") ) + spectrum_failures.at(j) );
+			}
+		}
+
+		// Only results that agree with the true values are worth recording
+		if ( record && failures.size() == 0 ){
+			gSystem->CopyFile( result_file, golden_file, true );
+			new_budgets << name << ".Time.Total: " << usage.total_time << std::endl;
+			for ( std::map<std::string,double>::const_iterator it = usage.stage_time.begin(); it != usage.stage_time.end(); ++it ){
+				new_budgets << name << ".Time." << it->first << ": " << it->second << std::endl;
+			}
+			new_budgets << name << ".MaxRSS: " << usage.max_rss << std::endl;
+		}
+		else if ( record ){
+			notes.push_back("Not recorded");
+		}
+		else{
+			if ( !have_budgets )missing.push_back( Form( "No budgets in %s (make test_record)", budget_file.Data() ) );
+			else CompareWithBudget( name, usage, budgets, tol, failures, missing );
+		}
+
+		// A check with nothing to compare with cannot pass
+		std::vector<TString> &unchecked = ( allow_missing ? notes : failures );
+		unchecked.insert( unchecked.end(), missing.begin(), missing.end() );
+
+		std::cout << name << ": " << ( failures.size() == 0 ? "PASSED" : "FAILED" ) << Form( " (%.3f s, %ld kB)", usage.total_time, usage.max_rss ) << std::endl;
+		for ( unsigned int j = 0; j < failures.size(); ++j ){
+			std::cout << "\t" << failures.at(j) << std::endl;
+		}
+		for ( unsigned int j = 0; j < notes.size(); ++j ){
+			std::cout << "\tSkipped: " << notes.at(j) << std::endl;
+		}
+		if ( failures.size() > 0 )number_failed++;
+	}
+
+	if ( record ){
+		new_budgets.close();
+		std::cout << "Recorded the results in " << golden_dir << " and the budgets in " << budget_file << std::endl;
+	}
+	std::cout << number_of_cases - number_failed << " of " << number_of_cases << " cases passed" << std::endl;
+
+	delete budgets;
+	delete corpus;
+	delete interface;
+	delete log;
+	return ( number_failed > 0 ? 1 : 0 );
+}